@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
 
@@ -49,4 +50,63 @@ static void CCoinsCaching(benchmark::State& state)
     }
 }
 
+// Lookups and inserts in a cache holding many coins, like the chainstate's
+// cache while connecting blocks
+static const size_t CACHE_COINS = 200000;
+
+static std::vector<COutPoint> RandomOutPoints(size_t count)
+{
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    }
+    return outpoints;
+}
+
+static Coin KeyHashCoin()
+{
+    Coin coin;
+    coin.out.nValue = COIN;
+    coin.out.scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG;
+    coin.nHeight = 1;
+    return coin;
+}
+
+static void CCoinsCacheLookup(benchmark::State& state)
+{
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    const std::vector<COutPoint> outpoints = RandomOutPoints(CACHE_COINS);
+    for (const COutPoint& outpoint : outpoints) {
+        coins.AddCoin(outpoint, KeyHashCoin(), false);
+    }
+
+    FastRandomContext rng(true);
+    while (state.KeepRunning()) {
+        const Coin& coin = coins.AccessCoin(outpoints[rng.randrange(CACHE_COINS)]);
+        assert(!coin.IsSpent());
+    }
+}
+
+static void CCoinsCacheInsert(benchmark::State& state)
+{
+    CCoinsView coinsDummy;
+    CCoinsViewCache coins(&coinsDummy);
+    const std::vector<COutPoint> outpoints = RandomOutPoints(CACHE_COINS);
+    const Coin coin = KeyHashCoin();
+
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        coins.AddCoin(outpoints[i], Coin(coin), false);
+        if (++i == CACHE_COINS) {
+            coins.Flush();
+            i = 0;
+        }
+    }
+}
+
 BENCHMARK(CCoinsCaching, 170 * 1000);
+BENCHMARK(CCoinsCacheLookup, 2 * 1000 * 1000);
+BENCHMARK(CCoinsCacheInsert, 2 * 1000 * 1000);
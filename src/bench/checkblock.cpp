@@ -6,7 +6,10 @@
 #include <bench/data.h>
 
 #include <chainparams.h>
+#include <crypto/common.h>
 #include <validation.h>
+#include <pow.h>
+#include <versionbits.h>
 #include <streams.h>
 #include <consensus/validation.h>
 
@@ -48,5 +51,48 @@ static void DeserializeAndCheckBlockTest(benchmark::State& state)
     }
 }
 
+// Accept a chain of 2000 fresh regtest headers, as when syncing headers from a
+// peer. Every iteration needs headers the node has not seen yet, so one chain
+// per iteration is mined up front; chains are told apart by their merkle root.
+static void ProcessNewBlockHeaders2000(benchmark::State& state)
+{
+    const CChainParams& chainparams = Params();
+    const CBlock& genesis = chainparams.GenesisBlock();
+    static constexpr size_t NUM_HEADERS{2000};
+
+    std::vector<std::vector<CBlockHeader>> chains(state.m_num_evals * state.m_num_iters);
+    for (size_t chain = 0; chain < chains.size(); ++chain) {
+        uint256 prev = genesis.GetHash();
+        for (size_t i = 0; i < NUM_HEADERS; ++i) {
+            CBlockHeader header;
+            header.nVersion = VERSIONBITS_TOP_BITS;
+            header.hashPrevBlock = prev;
+            WriteLE32(header.hashMerkleRoot.begin(), chain);
+            // Spaced so that every header qualifies for regtest's minimum difficulty
+            header.nTime = genesis.nTime + (i + 1) * 3 * chainparams.GetConsensus().nPowTargetSpacing;
+            header.nBits = genesis.nBits;
+            header.nNonce = 0;
+            // All regtest blocks after genesis are past both PoW forks
+            while (!CheckProofOfWork(header.GetPoWHash(true, true), header.nBits, true, chainparams.GetConsensus())) {
+                ++header.nNonce;
+            }
+            prev = header.GetHash();
+            chains[chain].push_back(header);
+        }
+    }
+
+    // The test setup enables the block index consistency check, which walks the
+    // whole index after every header and would dominate the measurement.
+    fCheckBlockIndex = false;
+    size_t chain = 0;
+    while (state.KeepRunning()) {
+        BlockValidationState validationState;
+        bool processed = ProcessNewBlockHeaders(chains.at(chain++), validationState, chainparams);
+        assert(processed);
+    }
+    fCheckBlockIndex = true;
+}
+
 BENCHMARK(DeserializeBlockTest, 130);
 BENCHMARK(DeserializeAndCheckBlockTest, 160);
+BENCHMARK(ProcessNewBlockHeaders2000, 10);
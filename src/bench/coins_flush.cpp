@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+
+#include <coins.h>
+#include <crypto/common.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <txdb.h>
+#include <version.h>
+
+#include <vector>
+
+// Replays the transactions of block 413567 as a chain of blocks. Each block
+// creates the outputs of the real one, and spends outputs of the last
+// MAX_LIFETIME blocks, as most coins are spent young. Whenever the coins cache
+// outgrows its limit, it is flushed to an in-memory coins database, either
+// wiping it or keeping the youngest coins up to a low watermark.
+
+static const int MAX_LIFETIME = 50;
+//! The cache limit, in blocks worth of coins
+static const size_t CACHE_BLOCKS = 10;
+
+static void ConnectBlocks(benchmark::State& state, int keep_percent)
+{
+    CBlock block;
+    CDataStream stream(benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION);
+    stream >> block;
+
+    CCoinsViewDB db("coinsdb_bench", 8 << 20, true, false);
+    CCoinsViewCache cache(&db);
+    size_t cache_limit = 0;
+    uint32_t height = 0;
+
+    // The outputs of a block at a height are its transactions' outputs, with
+    // the height mixed into the txids
+    auto outpoint = [&](uint32_t at_height, size_t tx, uint32_t n) {
+        uint256 txid = block.vtx[tx]->GetHash();
+        WriteLE32(txid.begin(), ReadLE32(txid.begin()) ^ at_height);
+        return COutPoint(txid, n);
+    };
+
+    auto connect_block = [&] {
+        ++height;
+        size_t output = 0;
+        for (size_t tx = 0; tx < block.vtx.size(); ++tx) {
+            for (uint32_t n = 0; n < block.vtx[tx]->vout.size(); ++n, ++output) {
+                if (block.vtx[tx]->vout[n].scriptPubKey.IsUnspendable()) continue;
+                const uint32_t lifetime = 1 + output % MAX_LIFETIME;
+                if (height > lifetime) {
+                    bool spent = cache.SpendCoin(outpoint(height - lifetime, tx, n));
+                    assert(spent);
+                }
+                cache.AddCoin(outpoint(height, tx, n), Coin(block.vtx[tx]->vout[n], height, tx == 0), false);
+            }
+        }
+        cache.SetBestBlock(block.vtx[0]->GetHash());
+        if (cache_limit != 0 && cache.DynamicMemoryUsage() > cache_limit) {
+            CCoinsMap coins;
+            cache.ReleaseCache(coins, cache_limit / 100 * keep_percent);
+            bool written = db.BatchWrite(coins, block.vtx[0]->GetHash());
+            assert(written);
+        }
+    };
+
+    // Size the cache from the first blocks, and get to a steady state
+    for (size_t i = 0; i < CACHE_BLOCKS; ++i) connect_block();
+    cache_limit = cache.DynamicMemoryUsage();
+    for (int i = 0; i < MAX_LIFETIME; ++i) connect_block();
+
+    while (state.KeepRunning()) {
+        connect_block();
+    }
+}
+
+static void CoinsFlushWipe(benchmark::State& state)
+{
+    ConnectBlocks(state, 0);
+}
+
+static void CoinsFlushKeep(benchmark::State& state)
+{
+    ConnectBlocks(state, 50);
+}
+
+BENCHMARK(CoinsFlushWipe, 20);
+BENCHMARK(CoinsFlushKeep, 20);
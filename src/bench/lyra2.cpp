@@ -0,0 +1,155 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/Lyra2RE/sph_blake.h>
+#include <crypto/Lyra2RE/sph_bmw.h>
+#include <crypto/Lyra2RE/sph_cubehash.h>
+#include <crypto/Lyra2RE/sph_groestl.h>
+#include <crypto/Lyra2RE/sph_keccak.h>
+#include <crypto/Lyra2RE/sph_skein.h>
+
+#include <vector>
+
+/* Size of a serialized block header, the input to the PoW hash functions */
+static const size_t HEADER_SIZE = 80;
+
+static void LYRA2RE(benchmark::State& state)
+{
+    std::vector<char> in(HEADER_SIZE, 0);
+    char hash[32];
+    while (state.KeepRunning()) {
+        lyra2re_hash(in.data(), hash);
+        in[76] ^= hash[0];
+    }
+}
+
+static void LYRA2REv2(benchmark::State& state)
+{
+    std::vector<char> in(HEADER_SIZE, 0);
+    char hash[32];
+    while (state.KeepRunning()) {
+        lyra2re2_hash(in.data(), hash);
+        in[76] ^= hash[0];
+    }
+}
+
+static void LYRA2REc0ban(benchmark::State& state)
+{
+    std::vector<char> in(HEADER_SIZE, 0);
+    char hash[32];
+    while (state.KeepRunning()) {
+        lyra2rec0ban_hash(in.data(), hash);
+        in[76] ^= hash[0];
+    }
+}
+
+static void LYRA2REc0ban_4way(benchmark::State& state)
+{
+    std::vector<char> in(4 * HEADER_SIZE, 0);
+    char hash[4][32];
+    const char* const inputs[4] = {&in[0], &in[HEADER_SIZE], &in[2 * HEADER_SIZE], &in[3 * HEADER_SIZE]};
+    char* const outputs[4] = {hash[0], hash[1], hash[2], hash[3]};
+    for (int i = 0; i < 4; ++i) in[i * HEADER_SIZE] = i;
+    while (state.KeepRunning()) {
+        lyra2rec0ban_hash_4way(inputs, outputs);
+        for (int i = 0; i < 4; ++i) in[i * HEADER_SIZE + 76] ^= hash[i][0];
+    }
+}
+
+static void LYRA2REc0ban_midstate(benchmark::State& state)
+{
+    std::vector<char> in(HEADER_SIZE, 0);
+    char hash[32];
+    lyra2_midstate midstate;
+    lyra2_midstate_init(&midstate, in.data());
+    while (state.KeepRunning()) {
+        lyra2rec0ban_hash_midstate(&midstate, in.data(), hash);
+        in[76] ^= hash[0];
+    }
+}
+
+// The sph primitives are benchmarked with the input sizes used by the chained
+// PoW hashes: blake256 hashes the 80 byte header, the rest a 32 byte digest.
+
+static void SPH_BLAKE256(benchmark::State& state)
+{
+    sph_blake256_context ctx;
+    std::vector<uint8_t> in(HEADER_SIZE, 0);
+    uint8_t hash[32];
+    while (state.KeepRunning()) {
+        sph_blake256_init(&ctx);
+        sph_blake256(&ctx, in.data(), in.size());
+        sph_blake256_close(&ctx, hash);
+    }
+}
+
+static void SPH_BMW256(benchmark::State& state)
+{
+    sph_bmw256_context ctx;
+    uint8_t hash[32] = {};
+    while (state.KeepRunning()) {
+        sph_bmw256_init(&ctx);
+        sph_bmw256(&ctx, hash, sizeof(hash));
+        sph_bmw256_close(&ctx, hash);
+    }
+}
+
+static void SPH_CUBEHASH256(benchmark::State& state)
+{
+    sph_cubehash256_context ctx;
+    uint8_t hash[32] = {};
+    while (state.KeepRunning()) {
+        sph_cubehash256_init(&ctx);
+        sph_cubehash256(&ctx, hash, sizeof(hash));
+        sph_cubehash256_close(&ctx, hash);
+    }
+}
+
+static void SPH_KECCAK256(benchmark::State& state)
+{
+    sph_keccak256_context ctx;
+    uint8_t hash[32] = {};
+    while (state.KeepRunning()) {
+        sph_keccak256_init(&ctx);
+        sph_keccak256(&ctx, hash, sizeof(hash));
+        sph_keccak256_close(&ctx, hash);
+    }
+}
+
+static void SPH_SKEIN256(benchmark::State& state)
+{
+    sph_skein256_context ctx;
+    uint8_t hash[32] = {};
+    while (state.KeepRunning()) {
+        sph_skein256_init(&ctx);
+        sph_skein256(&ctx, hash, sizeof(hash));
+        sph_skein256_close(&ctx, hash);
+    }
+}
+
+static void SPH_GROESTL256(benchmark::State& state)
+{
+    sph_groestl256_context ctx;
+    uint8_t hash[32] = {};
+    while (state.KeepRunning()) {
+        sph_groestl256_init(&ctx);
+        sph_groestl256(&ctx, hash, sizeof(hash));
+        sph_groestl256_close(&ctx, hash);
+    }
+}
+
+BENCHMARK(LYRA2RE, 160 * 1000);
+BENCHMARK(LYRA2REv2, 75 * 1000);
+BENCHMARK(LYRA2REc0ban, 65 * 1000);
+BENCHMARK(LYRA2REc0ban_4way, 15 * 1000);
+BENCHMARK(LYRA2REc0ban_midstate, 65 * 1000);
+
+BENCHMARK(SPH_BLAKE256, 2 * 1000 * 1000);
+BENCHMARK(SPH_BMW256, 3 * 1000 * 1000);
+BENCHMARK(SPH_CUBEHASH256, 220 * 1000);
+BENCHMARK(SPH_KECCAK256, 1500 * 1000);
+BENCHMARK(SPH_SKEIN256, 2400 * 1000);
+BENCHMARK(SPH_GROESTL256, 1100 * 1000);
@@ -0,0 +1,64 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <pow.h>
+#include <random.h>
+
+#include <vector>
+
+static const size_t CHAIN_LENGTH = 10000;
+
+/** A chain of block index entries with hashes, as the LWMA window is keyed on block hashes. */
+static void BuildChain(std::vector<CBlockIndex>& blocks, std::vector<uint256>& hashes)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    FastRandomContext rng(true);
+    blocks.resize(CHAIN_LENGTH);
+    hashes.resize(CHAIN_LENGTH);
+    for (size_t i = 0; i < CHAIN_LENGTH; ++i) {
+        hashes[i] = rng.rand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        blocks[i].nTime = i ? blocks[i - 1].nTime + 1 + rng.randrange(2 * params.nPowTargetSpacing) : 1500000000;
+        blocks[i].nBits = 0x1e0fffff;
+        blocks[i].BuildSkip();
+    }
+}
+
+// Difficulty of each next block in turn, as when syncing headers or connecting blocks
+static void LwmaNextWorkAdvance(benchmark::State& state)
+{
+    std::vector<CBlockIndex> blocks;
+    std::vector<uint256> hashes;
+    BuildChain(blocks, hashes);
+    const Consensus::Params& params = Params().GetConsensus();
+
+    size_t height = Params().AveragingWindow();
+    while (state.KeepRunning()) {
+        Lwma1CalculateNextWorkRequired(&blocks[height], params);
+        if (++height == CHAIN_LENGTH) height = Params().AveragingWindow();
+    }
+}
+
+// Difficulty on top of unrelated tips, which rebuilds the window every time
+static void LwmaNextWorkRandomTip(benchmark::State& state)
+{
+    std::vector<CBlockIndex> blocks;
+    std::vector<uint256> hashes;
+    BuildChain(blocks, hashes);
+    const Consensus::Params& params = Params().GetConsensus();
+    FastRandomContext rng(true);
+
+    while (state.KeepRunning()) {
+        const size_t height = Params().AveragingWindow() + rng.randrange(CHAIN_LENGTH - Params().AveragingWindow());
+        Lwma1CalculateNextWorkRequired(&blocks[height], params);
+    }
+}
+
+BENCHMARK(LwmaNextWorkAdvance, 150 * 1000);
+BENCHMARK(LwmaNextWorkRandomTip, 15 * 1000);
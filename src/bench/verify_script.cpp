@@ -4,6 +4,8 @@
 
 #include <bench/bench.h>
 #include <key.h>
+#include <policy/policy.h>
+#include <random.h>
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
@@ -91,7 +93,68 @@ static void VerifyNestedIfScript(benchmark::State& state) {
     }
 }
 
+/** Accepts every signature, leaving only the cost of script evaluation. */
+class AcceptingSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckSig(const std::vector<unsigned char>& vchSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const override
+    {
+        return true;
+    }
+};
+
+// Script evaluation around the signature check of P2PKH and P2WPKH spends.
+static void VerifyScriptKeyHash(benchmark::State& state)
+{
+    const unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_REPLAY_PROTECTION;
+    CKey key;
+    key.MakeNewKey(true);
+    const std::vector<unsigned char> pubkey = ToByteVector(key.GetPubKey());
+    std::vector<unsigned char> sig;
+    key.Sign(GetRandHash(), sig);
+    sig.push_back(SIGHASH_ALL | SIGHASH_FORKID);
+
+    const CScript p2pkh = GetScriptForDestination(PKHash(key.GetPubKey()));
+    const CScript p2wpkh = GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey().GetID()));
+    const CScript scriptSig = CScript() << sig << pubkey;
+    CScriptWitness witness;
+    witness.stack = {sig, pubkey};
+
+    const AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        bool success = VerifyScript(scriptSig, p2pkh, nullptr, flags, checker);
+        success &= VerifyScript(CScript(), p2wpkh, &witness, flags, checker);
+        assert(success);
+    }
+}
+
+// Script evaluation around the signature checks of a 2-of-3 P2SH multisig spend.
+static void VerifyScriptMultisig(benchmark::State& state)
+{
+    const unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_REPLAY_PROTECTION;
+    std::vector<CPubKey> pubkeys;
+    std::vector<std::vector<unsigned char>> sigs;
+    for (int i = 0; i < 3; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        pubkeys.push_back(key.GetPubKey());
+        sigs.emplace_back();
+        key.Sign(GetRandHash(), sigs.back());
+        sigs.back().push_back(SIGHASH_ALL | SIGHASH_FORKID);
+    }
+    const CScript redeem_script = GetScriptForMultisig(2, pubkeys);
+    const CScript p2sh = GetScriptForDestination(ScriptHash(redeem_script));
+    const CScript scriptSig = CScript() << OP_0 << sigs[0] << sigs[1] << ToByteVector(redeem_script);
+
+    const AcceptingSignatureChecker checker;
+    while (state.KeepRunning()) {
+        bool success = VerifyScript(scriptSig, p2sh, nullptr, flags, checker);
+        assert(success);
+    }
+}
 
 BENCHMARK(VerifyScriptBench, 6300);
+BENCHMARK(VerifyScriptKeyHash, 500 * 1000);
+BENCHMARK(VerifyScriptMultisig, 200 * 1000);
 
 BENCHMARK(VerifyNestedIfScript, 100);
@@ -14,6 +14,7 @@
 #include <versionbitsinfo.h>
 
 #include <assert.h>
+#include <limits>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -291,6 +292,7 @@ public:
         nZawyLwmaAveragingWindow = 8;
         nSwitchLyra2REv2_LWMA = 1;
         nSwitchLyra2REvc0ban_LWMA = 1;
+        nSwitchLyra2REvc0ban_LWMA_1 = std::numeric_limits<int>::max(); // Never: LWMA-1 ignores fPowNoRetargeting
 
         pchMessageStart[0] = 0xfa;
         pchMessageStart[1] = 0xbf;
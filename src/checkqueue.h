@@ -8,6 +8,9 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -16,6 +19,91 @@
 template <typename T>
 class CCheckQueueControl;
 
+/** The part of a CCheckQueue that the worker threads of a CCheckQueuePool use. */
+class CCheckQueueBase
+{
+public:
+    //! The number of worker queues. The master owns the first; beyond that many workers, workers share queues.
+    static const int WORKER_QUEUES = 64;
+
+    virtual ~CCheckQueueBase() {}
+
+    //! Whether there are queued checks that no worker has taken yet.
+    virtual bool HasWork() const = 0;
+
+    //! Take one batch of queued checks as the given worker and run it. Returns false if there was nothing to take.
+    virtual bool RunBatch(int nSlot) = 0;
+
+    //! Have checks spread over worker queues up to the given one from now on.
+    virtual void AddWorker(int nSlot) = 0;
+};
+
+/**
+ * Pool of worker threads shared by several CCheckQueues, so that kinds of work that are only
+ * queued now and then can use the same cores. Each queue is attached with a priority; a worker
+ * runs one batch at a time from the highest priority queue that has work (lowest number first),
+ * so work from lower priority queues only holds up a worker until its current batch is done.
+ *
+ * Queues are attached when they are constructed, and must be before the threads are started.
+ */
+class CCheckQueuePool
+{
+private:
+    //! Mutex to protect queues, nWorkers and going to sleep
+    boost::mutex mutex;
+
+    //! Worker threads block on this when none of the queues has work
+    boost::condition_variable condWorker;
+
+    //! The attached queues and their priorities, in order of priority
+    std::vector<std::pair<int, CCheckQueueBase*>> queues;
+
+    //! The number of worker threads that have started.
+    int nWorkers{0};
+
+public:
+    //! Attach a queue, so that the worker threads take checks from it.
+    void Attach(CCheckQueueBase& queue, int nPriority)
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        const auto it = std::upper_bound(queues.begin(), queues.end(), nPriority,
+            [](int n, const std::pair<int, CCheckQueueBase*>& entry) { return n < entry.first; });
+        queues.emplace(it, nPriority, &queue);
+    }
+
+    //! Wake up the workers, as a queue got checks.
+    void Notify()
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        condWorker.notify_all();
+    }
+
+    //! Worker thread
+    void Thread()
+    {
+        std::vector<CCheckQueueBase*> vQueues;
+        int nSlot;
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nSlot = 1 + nWorkers++ % (CCheckQueueBase::WORKER_QUEUES - 1);
+            for (const auto& entry : queues) {
+                entry.second->AddWorker(nSlot);
+                vQueues.push_back(entry.second);
+            }
+        }
+        const auto has_work = [](const CCheckQueueBase* queue) { return queue->HasWork(); };
+        do {
+            if (std::any_of(vQueues.begin(), vQueues.end(), [&](CCheckQueueBase* queue) { return queue->RunBatch(nSlot); })) {
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (std::none_of(vQueues.begin(), vQueues.end(), has_work)) {
+                condWorker.wait(lock);
+            }
+        } while (true);
+    }
+};
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,12 +113,42 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker has its own queue, which the master spreads new checks over.
+  * A worker takes batches from the back of its own queue and, when that is
+  * empty, steals from the front of the fullest other queue, so workers only
+  * contend when they steal. The shared mutex is only taken to go to sleep
+  * when there is no work at all and to wake the sleepers up.
   */
 template <typename T>
-class CCheckQueue
+class CCheckQueue : public CCheckQueueBase
 {
 private:
-    //! Mutex to protect the inner state
+    //! Checks queued for one worker
+    struct WorkerQueue {
+        //! Mutex to protect checks and head
+        std::mutex mutex;
+
+        //! The queued checks are checks[head, checks.size()). The owner takes from the back, thieves from the front.
+        std::vector<T> checks;
+        size_t head{0};
+
+        //! The number of queued checks, read without the lock to choose whom to steal from
+        std::atomic<size_t> size{0};
+    };
+
+    WorkerQueue slots[WORKER_QUEUES];
+
+    //! The number of worker queues that have an owner, and so get new checks.
+    std::atomic<int> nSlots{1};
+
+    //! The number of worker threads that have started.
+    std::atomic<int> nWorkers{0};
+
+    //! The worker queue Add starts spreading checks over. Only used by the master.
+    int nNextSlot{0};
+
+    //! Mutex to protect going to sleep and waking up
     boost::mutex mutex;
 
     //! Worker threads block on this when out of work
@@ -39,86 +157,117 @@ private:
     //! Master thread blocks on this when out of work
     boost::condition_variable condMaster;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue;
-
-    //! The number of workers (including the master) that are idle.
-    int nIdle;
-
-    //! The total number of workers (including the master).
-    int nTotal;
+    //! The number of checks in the worker queues. Only increased while holding mutex, so sleepers see the change.
+    std::atomic<int> nQueued{0};
 
     //! The temporary evaluation result.
-    bool fAllOk;
+    std::atomic<bool> fAllOk{true};
 
     /**
      * Number of verifications that haven't completed yet.
      * This includes elements that are no longer queued, but still in the
      * worker's own batches.
      */
-    unsigned int nTodo;
+    std::atomic<unsigned int> nTodo{0};
 
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! The pool whose threads work on this queue, if any
+    CCheckQueuePool* const pool;
+
+    /** Move a batch of checks from the back of a worker queue (or, for a thief, the front) into vChecks. */
+    unsigned int Take(WorkerQueue& queue, std::vector<T>& vChecks, bool fSteal)
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        const size_t nAvailable = queue.checks.size() - queue.head;
+        if (nAvailable == 0) return 0;
+        // Leave half of the queue for others to steal, so batches shrink as
+        // work runs out and all workers finish approximately simultaneously.
+        // Don't do batches smaller than 1 (duh), or larger than nBatchSize.
+        const unsigned int nNow = std::max<size_t>(1, std::min<size_t>(nBatchSize, (nAvailable + fSteal) / 2));
+        vChecks.resize(nNow);
+        // Swap jobs from the worker queue to the local batch vector instead of copying.
+        if (fSteal) {
+            for (unsigned int i = 0; i < nNow; i++) {
+                vChecks[i].swap(queue.checks[queue.head++]);
+            }
+        } else {
+            for (unsigned int i = 0; i < nNow; i++) {
+                vChecks[i].swap(queue.checks.back());
+                queue.checks.pop_back();
+            }
+        }
+        if (queue.head == queue.checks.size()) {
+            queue.checks.clear();
+            queue.head = 0;
+        }
+        queue.size = queue.checks.size() - queue.head;
+        nQueued -= nNow;
+        return nNow;
+    }
+
+    /** Take a batch of checks from our own worker queue, or else steal one from the fullest other worker queue. */
+    unsigned int TakeBatch(int nSlot, std::vector<T>& vChecks)
+    {
+        unsigned int nNow = Take(slots[nSlot], vChecks, false);
+        while (nNow == 0 && nQueued > 0) {
+            WorkerQueue* victim = nullptr;
+            size_t nVictimSize = 0;
+            for (int i = 0; i < nSlots; i++) {
+                const size_t size = slots[i].size.load(std::memory_order_relaxed);
+                if (i != nSlot && size > nVictimSize) {
+                    victim = &slots[i];
+                    nVictimSize = size;
+                }
+            }
+            if (!victim) break;
+            nNow = Take(*victim, vChecks, true);
+        }
+        return nNow;
+    }
+
+    /** Run a batch of taken checks. A worker that runs the last ones lets the master know. */
+    void RunTakenBatch(std::vector<T>& vChecks, unsigned int nNow, bool fMaster)
+    {
+        // Check whether we need to do work at all
+        bool fOk = fAllOk;
+        // execute work
+        for (T& check : vChecks)
+            if (fOk)
+                fOk = check();
+        vChecks.clear();
+        if (!fOk) fAllOk = false;
+        if ((nTodo -= nNow) == 0 && !fMaster) {
+            // We processed the last element; inform the master it can exit and return the result
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condMaster.notify_one();
+        }
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster = false)
+    bool Loop(int nSlot, bool fMaster = false)
     {
         boost::condition_variable& cond = fMaster ? condMaster : condWorker;
         std::vector<T> vChecks;
         vChecks.reserve(nBatchSize);
-        unsigned int nNow = 0;
-        bool fOk = true;
         do {
-            {
-                boost::unique_lock<boost::mutex> lock(mutex);
-                // first do the clean-up of the previous loop run (allowing us to do it in the same critsect)
-                if (nNow) {
-                    fAllOk &= fOk;
-                    nTodo -= nNow;
-                    if (nTodo == 0 && !fMaster)
-                        // We processed the last element; inform the master it can exit and return the result
-                        condMaster.notify_one();
-                } else {
-                    // first iteration
-                    nTotal++;
-                }
-                // logically, the do loop starts here
-                while (queue.empty()) {
-                    if (fMaster && nTodo == 0) {
-                        nTotal--;
-                        bool fRet = fAllOk;
-                        // reset the status for new work later
-                        fAllOk = true;
-                        // return the current status
-                        return fRet;
-                    }
-                    nIdle++;
-                    cond.wait(lock); // wait
-                    nIdle--;
-                }
-                // Decide how many work units to process now.
-                // * Do not try to do everything at once, but aim for increasingly smaller batches so
-                //   all workers finish approximately simultaneously.
-                // * Try to account for idle jobs which will instantly start helping.
-                // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
-                // Check whether we need to do work at all
-                fOk = fAllOk;
+            const unsigned int nNow = TakeBatch(nSlot, vChecks);
+            if (nNow) {
+                RunTakenBatch(vChecks, nNow, fMaster);
+                continue;
+            }
+            boost::unique_lock<boost::mutex> lock(mutex);
+            if (fMaster && nTodo == 0) {
+                bool fRet = fAllOk;
+                // reset the status for new work later
+                fAllOk = true;
+                // return the current status
+                return fRet;
+            }
+            if (nQueued <= 0) {
+                cond.wait(lock); // wait
             }
-            // execute work
-            for (T& check : vChecks)
-                if (fOk)
-                    fOk = check();
-            vChecks.clear();
         } while (true);
     }
 
@@ -126,34 +275,76 @@ public:
     //! Mutex to ensure only one concurrent CCheckQueueControl
     boost::mutex ControlMutex;
 
-    //! Create a new check queue
-    explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
+    //! Create a new check queue, worked on by its own threads or, if given, by those of a pool
+    explicit CCheckQueue(unsigned int nBatchSizeIn, CCheckQueuePool* poolIn = nullptr, int nPriority = 0) : nBatchSize(nBatchSizeIn), pool(poolIn)
+    {
+        if (pool) pool->Attach(*this, nPriority);
+    }
 
-    //! Worker thread
+    //! Worker thread, for queues without a pool
     void Thread()
     {
-        Loop();
+        const int nSlot = 1 + nWorkers++ % (WORKER_QUEUES - 1);
+        AddWorker(nSlot);
+        Loop(nSlot);
+    }
+
+    bool HasWork() const override
+    {
+        return nQueued > 0;
+    }
+
+    bool RunBatch(int nSlot) override
+    {
+        if (nQueued <= 0) return false;
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        const unsigned int nNow = TakeBatch(nSlot, vChecks);
+        if (nNow == 0) return false;
+        RunTakenBatch(vChecks, nNow, false);
+        return true;
+    }
+
+    void AddWorker(int nSlot) override
+    {
+        int nSlotsNow = nSlots;
+        while (nSlotsNow <= nSlot && !nSlots.compare_exchange_weak(nSlotsNow, nSlot + 1)) {}
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
-        return Loop(true);
+        return Loop(0, true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
-        boost::unique_lock<boost::mutex> lock(mutex);
-        for (T& check : vChecks) {
-            queue.push_back(T());
-            check.swap(queue.back());
-        }
+        if (vChecks.empty()) return;
         nTodo += vChecks.size();
+        // Spread the checks over the worker queues in runs, starting where the previous batch stopped
+        const int nSlotsNow = nSlots;
+        const size_t nRun = (vChecks.size() + nSlotsNow - 1) / nSlotsNow;
+        size_t nPos = 0;
+        while (nPos < vChecks.size()) {
+            nNextSlot = nNextSlot < nSlotsNow - 1 ? nNextSlot + 1 : 0;
+            WorkerQueue& queue = slots[nNextSlot];
+            const size_t nEnd = std::min(vChecks.size(), nPos + nRun);
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (; nPos < nEnd; nPos++) {
+                queue.checks.push_back(T());
+                vChecks[nPos].swap(queue.checks.back());
+            }
+            queue.size = queue.checks.size() - queue.head;
+        }
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nQueued += vChecks.size();
         if (vChecks.size() == 1)
             condWorker.notify_one();
-        else if (vChecks.size() > 1)
+        else
             condWorker.notify_all();
+        lock.unlock();
+        if (pool) pool->Notify();
     }
 
     ~CCheckQueue()
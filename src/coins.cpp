@@ -9,6 +9,9 @@
 #include <random.h>
 #include <version.h>
 
+#include <algorithm>
+#include <functional>
+
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
@@ -46,7 +49,7 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
-    CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
+    CCoinsMap::iterator ret = cacheCoins.try_emplace(outpoint, std::move(tmp)).first;
     if (ret->second.coin.IsSpent()) {
         // The parent only has an empty entry for this outpoint; we can consider our
         // version as fresh.
@@ -70,7 +73,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     if (coin.out.scriptPubKey.IsUnspendable()) return;
     CCoinsMap::iterator it;
     bool inserted;
-    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+    std::tie(it, inserted) = cacheCoins.try_emplace(outpoint);
     bool fresh = false;
     if (!inserted) {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
@@ -86,6 +89,16 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
 }
 
+void CCoinsViewCache::AddFetchedCoin(const COutPoint& outpoint, Coin&& coin) {
+    assert(!coin.IsSpent());
+    CCoinsMap::iterator it;
+    bool inserted;
+    std::tie(it, inserted) = cacheCoins.try_emplace(outpoint, std::move(coin));
+    if (inserted) {
+        cachedCoinsUsage += it->second.coin.DynamicMemoryUsage();
+    }
+}
+
 void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, bool check) {
     bool fCoinbase = tx.IsCoinBase();
     const uint256& txid = tx.GetHash();
@@ -209,6 +222,50 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+void CCoinsViewCache::ReleaseCache(CCoinsMap& coins, size_t keep_bytes)
+{
+    std::vector<std::pair<COutPoint, Coin>> kept;
+    if (keep_bytes > 0 && !cacheCoins.empty()) {
+        // Estimate how many entries fit, from the average memory per entry
+        const size_t entry_usage = DynamicMemoryUsage() / cacheCoins.size() + 1;
+        const size_t keep_count = keep_bytes / entry_usage;
+
+        std::vector<uint32_t> heights;
+        heights.reserve(cacheCoins.size());
+        for (const auto& entry : cacheCoins) {
+            if (!entry.second.coin.IsSpent()) heights.push_back(entry.second.coin.nHeight);
+        }
+        if (keep_count > 0 && !heights.empty()) {
+            // Keep the coins above the height of the keep_count-th youngest
+            // coin, and as many as still fit at that height
+            uint32_t min_height = 0;
+            size_t at_min_height = heights.size();
+            if (keep_count < heights.size()) {
+                std::nth_element(heights.begin(), heights.begin() + keep_count - 1, heights.end(), std::greater<uint32_t>());
+                min_height = heights[keep_count - 1];
+                at_min_height = keep_count - std::count_if(heights.begin(), heights.end(), [&](uint32_t height) { return height > min_height; });
+            }
+            kept.reserve(std::min(keep_count, heights.size()));
+            for (const auto& entry : cacheCoins) {
+                const Coin& coin = entry.second.coin;
+                if (coin.IsSpent() || coin.nHeight < min_height) continue;
+                if (coin.nHeight == min_height) {
+                    if (at_min_height == 0) continue;
+                    --at_min_height;
+                }
+                kept.emplace_back(entry.first, coin);
+            }
+        }
+    }
+
+    assert(coins.empty());
+    cacheCoins.swap(coins);
+    cachedCoinsUsage = 0;
+    for (auto& coin : kept) {
+        AddFetchedCoin(coin.first, std::move(coin.second));
+    }
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -11,6 +11,7 @@
 #include <core_memusage.h>
 #include <crypto/siphash.h>
 #include <memusage.h>
+#include <pooledmap.h>
 #include <serialize.h>
 #include <uint256.h>
 
@@ -86,7 +87,7 @@ class SaltedOutpointHasher
 {
 private:
     /** Salt */
-    const uint64_t k0, k1;
+    uint64_t k0, k1;
 
 public:
     SaltedOutpointHasher();
@@ -128,7 +129,7 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+typedef pooledmap<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -263,6 +264,13 @@ public:
      */
     void AddCoin(const COutPoint& outpoint, Coin&& coin, bool potential_overwrite);
 
+    /**
+     * Add a coin read from the backing view by someone else, exactly as if
+     * this cache had fetched it itself. Has no effect if the outpoint is
+     * already cached.
+     */
+    void AddFetchedCoin(const COutPoint& outpoint, Coin&& coin);
+
     /**
      * Spend a coin. Pass moveto in order to get the deleted data.
      * If no unspent output exists for the passed outpoint, this call
@@ -277,6 +285,17 @@ public:
      */
     bool Flush();
 
+    /**
+     * Move all entries of this cache into coins, leaving the cache empty as
+     * Flush() does, for the caller to write them to the base itself.
+     *
+     * With keep_bytes, copies of the most recently created unspent coins,
+     * which are the most likely to be spent soon, stay in the cache as
+     * unmodified entries, using up to about keep_bytes of memory. They must
+     * be in the base once coins are written.
+     */
+    void ReleaseCache(CCoinsMap& coins, size_t keep_bytes = 0);
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
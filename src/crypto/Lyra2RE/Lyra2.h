@@ -37,8 +37,24 @@ typedef unsigned char byte;
         #define BLOCK_LEN_BYTES (BLOCK_LEN_INT64 * 8)    //Block length, in bytes
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 int LYRA2(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
 
 int LYRA2_old(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost, uint64_t nRows, uint64_t nCols);
 
+//Allocation-free variants with fixed matrix dimensions
+void LYRA2_4x4(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost);
+
+void LYRA2_old_8x8(void *K, uint64_t kLen, const void *pwd, uint64_t pwdlen, const void *salt, uint64_t saltlen, uint64_t timeCost);
+
+//Four LYRA2_4x4 computations with 32-byte key, password and salt (salt == password) and timeCost 1
+void LYRA2_4x4_4way(void *const K[4], const void *const pwd[4]);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* LYRA2_H_ */
@@ -28,6 +28,7 @@
  */
 
 #include "Lyra2RE.h"
+#include <assert.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
@@ -39,6 +40,7 @@
 #include "sph_keccak.h"
 #include "sph_skein.h"
 #include "Lyra2.h"
+#include "Sponge.h"
 
 void lyra2re_hash(const char* input, char* output)
 {
@@ -57,7 +59,7 @@ void lyra2re_hash(const char* input, char* output)
     sph_keccak256 (&ctx_keccak,hashA, 32); 
     sph_keccak256_close(&ctx_keccak, hashB);
 	
-	LYRA2_old(hashA, 32, hashB, 32, hashB, 32, 1, 8, 8);
+	LYRA2_old_8x8(hashA, 32, hashB, 32, hashB, 32, 1);
 	
 	sph_skein256_init(&ctx_skein);
     sph_skein256 (&ctx_skein, hashA, 32); 
@@ -70,19 +72,15 @@ void lyra2re_hash(const char* input, char* output)
 	memcpy(output, hashA, 32);
 }
 
-void lyra2re2_hash(const char* input, char* output)
+/** The steps of lyra2re2_hash after Blake256; hashA holds the Blake256 hash and is overwritten. */
+static void lyra2re2_tail(uint32_t hashA[8], char* output)
 {
-	sph_blake256_context ctx_blake;
 	sph_cubehash256_context ctx_cubehash;
 	sph_keccak256_context ctx_keccak;
 	sph_skein256_context ctx_skein;
 	sph_bmw256_context ctx_bmw;
 
-	uint32_t hashA[8], hashB[8];
-
-	sph_blake256_init(&ctx_blake);
-    sph_blake256(&ctx_blake, input, 80);
-    sph_blake256_close (&ctx_blake, hashA);
+	uint32_t hashB[8];
 
     sph_keccak256_init(&ctx_keccak);
     sph_keccak256(&ctx_keccak, hashA, 32);
@@ -92,7 +90,7 @@ void lyra2re2_hash(const char* input, char* output)
     sph_cubehash256(&ctx_cubehash, hashB, 32);
     sph_cubehash256_close(&ctx_cubehash, hashA);
 
-    LYRA2(hashB, 32, hashA, 32, hashA, 32, 1, 4, 4);
+    LYRA2_4x4(hashB, 32, hashA, 32, hashA, 32, 1);
 
    	sph_skein256_init(&ctx_skein);
     sph_skein256(&ctx_skein, hashB, 32);
@@ -109,19 +107,15 @@ void lyra2re2_hash(const char* input, char* output)
    	memcpy(output, hashA, 32);
 }
 
-void lyra2rec0ban_hash(const char* input, char* output)
+/** The steps of lyra2rec0ban_hash after Blake256; hashA holds the Blake256 hash and is overwritten. */
+static void lyra2rec0ban_tail(uint32_t hashA[8], char* output)
 {
-	sph_blake256_context ctx_blake;
 	sph_cubehash256_context ctx_cubehash;
 	sph_keccak256_context ctx_keccak;
 	sph_skein256_context ctx_skein;
 	sph_bmw256_context ctx_bmw;
 
-	uint32_t hashA[8], hashB[8];
-
-	sph_blake256_init(&ctx_blake);
-    sph_blake256(&ctx_blake, input, 80);
-    sph_blake256_close (&ctx_blake, hashA);
+	uint32_t hashB[8];
 
     sph_cubehash256_init(&ctx_cubehash);
     sph_cubehash256(&ctx_cubehash, hashA, 32);
@@ -131,7 +125,7 @@ void lyra2rec0ban_hash(const char* input, char* output)
     sph_cubehash256(&ctx_cubehash, hashB, 32);
     sph_cubehash256_close(&ctx_cubehash, hashA);
 
-    LYRA2(hashB, 32, hashA, 32, hashA, 32, 1, 4, 4);
+    LYRA2_4x4(hashB, 32, hashA, 32, hashA, 32, 1);
 
    	sph_skein256_init(&ctx_skein);
     sph_skein256(&ctx_skein, hashB, 32);
@@ -147,3 +141,215 @@ void lyra2rec0ban_hash(const char* input, char* output)
 
    	memcpy(output, hashA, 32);
 }
+
+/** Four lyra2re2_tail computations. The Lyra2 step, which dominates the cost, runs the four in parallel when the CPU allows. */
+static void lyra2re2_tail_4way(uint32_t hashA[4][8], char* const output[4])
+{
+	sph_cubehash256_context ctx_cubehash;
+	sph_keccak256_context ctx_keccak;
+	sph_skein256_context ctx_skein;
+	sph_bmw256_context ctx_bmw;
+
+	uint32_t hashB[4][8];
+	void* lyraOut[4] = {hashB[0], hashB[1], hashB[2], hashB[3]};
+	const void* lyraIn[4] = {hashA[0], hashA[1], hashA[2], hashA[3]};
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		sph_keccak256_init(&ctx_keccak);
+		sph_keccak256(&ctx_keccak, hashA[i], 32);
+		sph_keccak256_close(&ctx_keccak, hashB[i]);
+
+		sph_cubehash256_init(&ctx_cubehash);
+		sph_cubehash256(&ctx_cubehash, hashB[i], 32);
+		sph_cubehash256_close(&ctx_cubehash, hashA[i]);
+	}
+
+	LYRA2_4x4_4way(lyraOut, lyraIn);
+
+	for (i = 0; i < 4; i++) {
+		sph_skein256_init(&ctx_skein);
+		sph_skein256(&ctx_skein, hashB[i], 32);
+		sph_skein256_close(&ctx_skein, hashA[i]);
+
+		sph_cubehash256_init(&ctx_cubehash);
+		sph_cubehash256(&ctx_cubehash, hashA[i], 32);
+		sph_cubehash256_close(&ctx_cubehash, hashB[i]);
+
+		sph_bmw256_init(&ctx_bmw);
+		sph_bmw256(&ctx_bmw, hashB[i], 32);
+		sph_bmw256_close(&ctx_bmw, hashA[i]);
+
+		memcpy(output[i], hashA[i], 32);
+	}
+}
+
+/** Four lyra2rec0ban_tail computations (see lyra2re2_tail_4way). */
+static void lyra2rec0ban_tail_4way(uint32_t hashA[4][8], char* const output[4])
+{
+	sph_cubehash256_context ctx_cubehash;
+	sph_keccak256_context ctx_keccak;
+	sph_skein256_context ctx_skein;
+	sph_bmw256_context ctx_bmw;
+
+	uint32_t hashB[4][8];
+	void* lyraOut[4] = {hashB[0], hashB[1], hashB[2], hashB[3]};
+	const void* lyraIn[4] = {hashA[0], hashA[1], hashA[2], hashA[3]};
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		sph_cubehash256_init(&ctx_cubehash);
+		sph_cubehash256(&ctx_cubehash, hashA[i], 32);
+		sph_cubehash256_close(&ctx_cubehash, hashB[i]);
+
+		sph_cubehash256_init(&ctx_cubehash);
+		sph_cubehash256(&ctx_cubehash, hashB[i], 32);
+		sph_cubehash256_close(&ctx_cubehash, hashA[i]);
+	}
+
+	LYRA2_4x4_4way(lyraOut, lyraIn);
+
+	for (i = 0; i < 4; i++) {
+		sph_skein256_init(&ctx_skein);
+		sph_skein256(&ctx_skein, hashB[i], 32);
+		sph_skein256_close(&ctx_skein, hashA[i]);
+
+		sph_keccak256_init(&ctx_keccak);
+		sph_keccak256(&ctx_keccak, hashA[i], 32);
+		sph_keccak256_close(&ctx_keccak, hashB[i]);
+
+		sph_bmw256_init(&ctx_bmw);
+		sph_bmw256(&ctx_bmw, hashB[i], 32);
+		sph_bmw256_close(&ctx_bmw, hashA[i]);
+
+		memcpy(output[i], hashA[i], 32);
+	}
+}
+
+static void blake256_header(const char* input, uint32_t hash[8])
+{
+	sph_blake256_context ctx_blake;
+
+	sph_blake256_init(&ctx_blake);
+	sph_blake256(&ctx_blake, input, 80);
+	sph_blake256_close(&ctx_blake, hash);
+}
+
+/** Blake256 of an 80-byte header whose first 64 bytes were absorbed into midstate. */
+static void blake256_header_midstate(const lyra2_midstate* midstate, const char* input, uint32_t hash[8])
+{
+	sph_blake256_context ctx_blake = midstate->blake;
+
+	sph_blake256(&ctx_blake, input + LYRA2_MIDSTATE_BYTES, 80 - LYRA2_MIDSTATE_BYTES);
+	sph_blake256_close(&ctx_blake, hash);
+}
+
+void lyra2re2_hash(const char* input, char* output)
+{
+	uint32_t hashA[8];
+
+	blake256_header(input, hashA);
+	lyra2re2_tail(hashA, output);
+}
+
+void lyra2rec0ban_hash(const char* input, char* output)
+{
+	uint32_t hashA[8];
+
+	blake256_header(input, hashA);
+	lyra2rec0ban_tail(hashA, output);
+}
+
+void lyra2re2_hash_4way(const char* const input[4], char* const output[4])
+{
+	uint32_t hashA[4][8];
+	int i;
+
+	for (i = 0; i < 4; i++) blake256_header(input[i], hashA[i]);
+	lyra2re2_tail_4way(hashA, output);
+}
+
+void lyra2rec0ban_hash_4way(const char* const input[4], char* const output[4])
+{
+	uint32_t hashA[4][8];
+	int i;
+
+	for (i = 0; i < 4; i++) blake256_header(input[i], hashA[i]);
+	lyra2rec0ban_tail_4way(hashA, output);
+}
+
+void lyra2_midstate_init(lyra2_midstate* midstate, const char* input)
+{
+	sph_blake256_init(&midstate->blake);
+	sph_blake256(&midstate->blake, input, LYRA2_MIDSTATE_BYTES);
+}
+
+void lyra2re2_hash_midstate(const lyra2_midstate* midstate, const char* input, char* output)
+{
+	uint32_t hashA[8];
+
+	blake256_header_midstate(midstate, input, hashA);
+	lyra2re2_tail(hashA, output);
+}
+
+void lyra2rec0ban_hash_midstate(const lyra2_midstate* midstate, const char* input, char* output)
+{
+	uint32_t hashA[8];
+
+	blake256_header_midstate(midstate, input, hashA);
+	lyra2rec0ban_tail(hashA, output);
+}
+
+void lyra2re2_hash_4way_midstate(const lyra2_midstate* midstate, const char* const input[4], char* const output[4])
+{
+	uint32_t hashA[4][8];
+	int i;
+
+	for (i = 0; i < 4; i++) blake256_header_midstate(midstate, input[i], hashA[i]);
+	lyra2re2_tail_4way(hashA, output);
+}
+
+void lyra2rec0ban_hash_4way_midstate(const lyra2_midstate* midstate, const char* const input[4], char* const output[4])
+{
+	uint32_t hashA[4][8];
+	int i;
+
+	for (i = 0; i < 4; i++) blake256_header_midstate(midstate, input[i], hashA[i]);
+	lyra2rec0ban_tail_4way(hashA, output);
+}
+
+/**
+ * Check the sponge in use against the generic one: Lyra2RE (8x8) of an all-zero header and the
+ * Lyra2 4x4 core of Lyra2REv2 and Lyra2REc0ban on an all-zero key, which leaves out their other
+ * hash functions.
+ */
+static int Lyra2SelfTest(void)
+{
+    static const unsigned char lyra2re_zero[32] = {
+        0xc6, 0x16, 0x5c, 0xb3, 0xa8, 0x2b, 0x8f, 0x39, 0xed, 0x9f, 0xea, 0xa5, 0xfa, 0x5b, 0xe3, 0xd7,
+        0x04, 0x1b, 0x0f, 0xd3, 0x01, 0x28, 0xa4, 0x2e, 0xd0, 0xb7, 0x8f, 0xf2, 0xb6, 0x65, 0xf8, 0x1a
+    };
+    static const unsigned char lyra2_4x4_zero[32] = {
+        0xa7, 0xe7, 0x91, 0x03, 0xb9, 0xc0, 0xbb, 0x08, 0xbb, 0xd1, 0x3d, 0x8c, 0xeb, 0x3b, 0xca, 0x62,
+        0xe3, 0xef, 0xef, 0x67, 0xe3, 0x58, 0x68, 0xd3, 0x20, 0x37, 0x9b, 0x00, 0xa4, 0x45, 0x8a, 0x67
+    };
+    char input[80] = {0};
+    char output[32];
+
+    lyra2re_hash(input, output);
+    if (memcmp(output, lyra2re_zero, 32) != 0) return 0;
+    LYRA2_4x4(output, 32, input, 32, input, 32, 1);
+    if (memcmp(output, lyra2_4x4_zero, 32) != 0) return 0;
+    return 1;
+}
+
+const char* Lyra2AutoDetect(void)
+{
+    if (!Lyra2SelectSponge(LYRA2_SPONGE_AVX2) &&
+        !Lyra2SelectSponge(LYRA2_SPONGE_SSSE3) &&
+        !Lyra2SelectSponge(LYRA2_SPONGE_SSE2)) {
+        Lyra2SelectSponge(LYRA2_SPONGE_GENERIC);
+    }
+    assert(Lyra2SelfTest());
+    return spongeImplName();
+}
@@ -1,6 +1,8 @@
 #ifndef LYRA2RE_H
 #define LYRA2RE_H
 
+#include "sph_blake.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,6 +11,46 @@ void lyra2re_hash(const char* input, char* output);
 void lyra2re2_hash(const char* input, char* output);
 void lyra2rec0ban_hash(const char* input, char* output);
 
+/** Hash four 80-byte inputs at once, in parallel SIMD lanes where supported. */
+void lyra2re2_hash_4way(const char* const input[4], char* const output[4]);
+void lyra2rec0ban_hash_4way(const char* const input[4], char* const output[4]);
+
+/**
+ * Number of leading header bytes a midstate covers: version, previous block hash and most of the
+ * merkle root. They do not change while a miner rolls the nonce or the time.
+ */
+#define LYRA2_MIDSTATE_BYTES 64
+
+/** Blake256 state after the first LYRA2_MIDSTATE_BYTES of an 80-byte header. */
+typedef struct {
+    sph_blake256_context blake;
+} lyra2_midstate;
+
+void lyra2_midstate_init(lyra2_midstate* midstate, const char* input);
+
+/**
+ * lyra2re2_hash and lyra2rec0ban_hash of headers whose first LYRA2_MIDSTATE_BYTES are the ones
+ * midstate was initialized with. Only the remaining bytes of input are read.
+ */
+void lyra2re2_hash_midstate(const lyra2_midstate* midstate, const char* input, char* output);
+void lyra2rec0ban_hash_midstate(const lyra2_midstate* midstate, const char* input, char* output);
+void lyra2re2_hash_4way_midstate(const lyra2_midstate* midstate, const char* const input[4], char* const output[4]);
+void lyra2rec0ban_hash_4way_midstate(const lyra2_midstate* midstate, const char* const input[4], char* const output[4]);
+
+/** Implementations of the Blake2b-based sponge inside Lyra2 */
+enum lyra2_sponge {
+    LYRA2_SPONGE_GENERIC,
+    LYRA2_SPONGE_SSE2,
+    LYRA2_SPONGE_SSSE3,
+    LYRA2_SPONGE_AVX2,
+};
+
+/** Select the fastest sponge implementation supported by this CPU and return its name. */
+const char* Lyra2AutoDetect(void);
+
+/** Use the given sponge implementation. Returns 0 (and changes nothing) if it is unavailable. */
+int Lyra2SelectSponge(enum lyra2_sponge which);
+
 #ifdef __cplusplus
 }
 #endif
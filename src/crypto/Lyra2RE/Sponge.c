@@ -18,11 +18,39 @@
  * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
  * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <stdatomic.h>
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
 #include "Sponge.h"
 #include "Lyra2.h"
+#include "Lyra2RE.h"
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__)) && defined(__GNUC__)
+#define HAVE_SPONGE_CPUID
+#include <cpuid.h>
+#endif
+
+static const spongeImpl spongeImplGeneric;
+
+/**
+ * The implementation in use, set by Lyra2AutoDetect at startup before any hashing is done. It is
+ * atomic so that a later Lyra2SelectSponge (as the tests do) cannot race with hashing threads;
+ * every implementation computes the same function, so hashes in flight are not affected.
+ */
+static _Atomic(const spongeImpl *) impl = &spongeImplGeneric;
+
+static inline const spongeImpl *spongeImplInUse(void) {
+    return atomic_load_explicit(&impl, memory_order_acquire);
+}
+
+static inline void spongeImplSet(const spongeImpl *which) {
+    atomic_store_explicit(&impl, which, memory_order_release);
+}
 
 
 
@@ -56,7 +84,7 @@ inline void initState(uint64_t state[/*16*/]) {
  *
  * @param v     A 1024-bit (16 uint64_t) array to be processed by Blake2b's G function
  */
-inline static void blake2bLyra(uint64_t *v) {
+static void blake2bLyra_generic(uint64_t *v) {
     ROUND_LYRA(0);
     ROUND_LYRA(1);
     ROUND_LYRA(2);
@@ -94,7 +122,7 @@ inline void squeeze(uint64_t *state, byte *out, unsigned int len) {
     //Squeezes full blocks
     for (i = 0; i < fullBlocks; i++) {
 	memcpy(ptr, state, BLOCK_LEN_BYTES);
-	blake2bLyra(state);
+	spongeImplInUse()->blake2bLyra(state);
 	ptr += BLOCK_LEN_BYTES;
     }
 
@@ -125,7 +153,7 @@ inline void absorbBlock(uint64_t *state, const uint64_t *in) {
     state[11] ^= in[11];
 
     //Applies the transformation f to the sponge's state
-    blake2bLyra(state);
+    spongeImplInUse()->blake2bLyra(state);
 }
 
 /**
@@ -149,7 +177,7 @@ inline void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in) {
 
 
     //Applies the transformation f to the sponge's state
-    blake2bLyra(state);
+    spongeImplInUse()->blake2bLyra(state);
 
 }
 
@@ -161,7 +189,7 @@ inline void absorbBlockBlake2Safe(uint64_t *state, const uint64_t *in) {
  * @param state     The current state of the sponge
  * @param rowOut    Row to receive the data squeezed
  */
-inline void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+static void reducedSqueezeRow0_generic(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
     uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
     int i;
     //M[row][C-1-col] = H.reduced_squeeze()
@@ -196,7 +224,7 @@ inline void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols
  * @param rowIn		Row to feed the sponge
  * @param rowOut	Row to receive the sponge's output
  */
-inline void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRow1_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
     uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
     uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
     int i;
@@ -256,7 +284,7 @@ inline void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut
  * @param rowOut         Row receiving the output
  *
  */
-inline void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRowSetup_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
     uint64_t* ptrWordIn = rowIn;				//In Lyra2: pointer to prev
     uint64_t* ptrWordInOut = rowInOut;				//In Lyra2: pointer to row*
     uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to row
@@ -330,7 +358,7 @@ inline void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *ro
  * @param rowOut         Row receiving the output
  *
  */
-inline void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+static void reducedDuplexRow_generic(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
     uint64_t* ptrWordInOut = rowInOut; //In Lyra2: pointer to row*
     uint64_t* ptrWordIn = rowIn; //In Lyra2: pointer to prev
     uint64_t* ptrWordOut = rowOut; //In Lyra2: pointer to row
@@ -391,6 +419,105 @@ inline void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOu
 }
 
 
+static const spongeImpl spongeImplGeneric = {
+    "generic",
+    blake2bLyra_generic,
+    reducedSqueezeRow0_generic,
+    reducedDuplexRow1_generic,
+    reducedDuplexRowSetup_generic,
+    reducedDuplexRow_generic,
+    NULL
+};
+
+void reducedSqueezeRow0(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+    spongeImplInUse()->reducedSqueezeRow0(state, rowOut, nCols);
+}
+
+void reducedDuplexRow1(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+    spongeImplInUse()->reducedDuplexRow1(state, rowIn, rowOut, nCols);
+}
+
+void reducedDuplexRowSetup(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    spongeImplInUse()->reducedDuplexRowSetup(state, rowIn, rowInOut, rowOut, nCols);
+}
+
+void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    spongeImplInUse()->reducedDuplexRow(state, rowIn, rowInOut, rowOut, nCols);
+}
+
+#if defined(HAVE_SPONGE_CPUID) && defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+/** Check whether the OS has enabled AVX registers. */
+static int spongeAVXEnabled(void) {
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+
+/**
+ * Selects the sponge implementation used by all subsequent Lyra2 computations.
+ *
+ * @return 1 if the implementation is compiled in and supported by this CPU, 0 otherwise
+ */
+int Lyra2SelectSponge(enum lyra2_sponge which) {
+#if defined(HAVE_SPONGE_CPUID)
+    uint32_t eax = 0, ebx = 0, ecx = 0, edx = 0;
+    __cpuid_count(1, 0, eax, ebx, ecx, edx);
+#endif
+
+    switch (which) {
+    case LYRA2_SPONGE_GENERIC:
+        spongeImplSet(&spongeImplGeneric);
+        return 1;
+#if defined(HAVE_SPONGE_CPUID) && defined(__SSE2__)
+    case LYRA2_SPONGE_SSE2:
+        if ((edx >> 26) & 1) {
+            spongeImplSet(&spongeImplSSE2);
+            return 1;
+        }
+        return 0;
+#endif
+#if defined(HAVE_SPONGE_CPUID) && defined(ENABLE_SSSE3) && !defined(BUILD_BITCOIN_INTERNAL)
+    case LYRA2_SPONGE_SSSE3:
+        if ((ecx >> 9) & 1) {
+            spongeImplSet(&spongeImplSSSE3);
+            return 1;
+        }
+        return 0;
+#endif
+#if defined(HAVE_SPONGE_CPUID) && defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    case LYRA2_SPONGE_AVX2:
+        if (((ecx >> 27) & 1) && ((ecx >> 28) & 1) && spongeAVXEnabled()) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            if ((ebx >> 5) & 1) {
+                spongeImplSet(&spongeImplAVX2);
+                return 1;
+            }
+        }
+        return 0;
+#endif
+    default:
+        return 0;
+    }
+}
+
+const char* spongeImplName(void) {
+    return spongeImplInUse()->name;
+}
+
+/**
+ * Runs the four-lane LYRA2_4x4 of the selected implementation.
+ *
+ * @return 1 if it has one, 0 (without computing anything) otherwise
+ */
+int spongeLyra2_4x4_4way(void *const K[4], const void *const pwd[4]) {
+    const spongeImpl *in_use = spongeImplInUse();
+    if (in_use->lyra2_4x4_4way == NULL) return 0;
+    in_use->lyra2_4x4_4way(K, pwd);
+    return 1;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 /**
@@ -22,6 +22,7 @@
 #ifndef SPONGE_H_
 #define SPONGE_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #if defined(__GNUC__)
@@ -92,6 +93,25 @@ void reducedDuplexRow(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint
 //---- Misc
 void printArray(unsigned char *array, unsigned int size, char *name);
 
+//---- Runtime-selected implementations of the permutation and row operations
+typedef struct {
+    const char *name;
+    void (*blake2bLyra)(uint64_t *v);
+    void (*reducedSqueezeRow0)(uint64_t* state, uint64_t* row, uint64_t nCols);
+    void (*reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols);
+    void (*reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+    void (*reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols);
+    /* Four-lane LYRA2_4x4 (see LYRA2_4x4_4way), or NULL if this implementation has none */
+    void (*lyra2_4x4_4way)(void *const K[4], const void *const pwd[4]);
+} spongeImpl;
+
+extern const spongeImpl spongeImplSSE2;
+extern const spongeImpl spongeImplSSSE3;
+extern const spongeImpl spongeImplAVX2;
+
+const char* spongeImplName(void);
+int spongeLyra2_4x4_4way(void *const K[4], const void *const pwd[4]);
+
 ////////////////////////////////////////////////////////////////////////////////////////////////
 
 
@@ -0,0 +1,313 @@
+/**
+ * AVX2 implementation of the Blake2b-based sponge used by Lyra2. The results
+ * are bit-identical to the generic implementation in Sponge.c.
+ *
+ * The 16-word sponge state is kept in four 256-bit registers a, b, c and d,
+ * one per row of Blake2b's 4x4 state matrix, so the four G functions of each
+ * half-round run in parallel. The 12-word bitrate is a, b and c.
+ *
+ * This software is hereby placed in the public domain.
+ */
+#ifdef ENABLE_AVX2
+
+#include "Sponge.h"
+#include "Lyra2.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+#define ROTR32(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24(x) _mm256_shuffle_epi8((x), _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10, \
+                                                            3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16(x) _mm256_shuffle_epi8((x), _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9, \
+                                                            2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR63(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+/* Blake2b's G function applied to all four columns (or diagonals) at once */
+#define G4(a, b, c, d) \
+  do { \
+    a = _mm256_add_epi64(a, b); d = ROTR32(_mm256_xor_si256(d, a)); \
+    c = _mm256_add_epi64(c, d); b = ROTR24(_mm256_xor_si256(b, c)); \
+    a = _mm256_add_epi64(a, b); d = ROTR16(_mm256_xor_si256(d, a)); \
+    c = _mm256_add_epi64(c, d); b = ROTR63(_mm256_xor_si256(b, c)); \
+  } while(0)
+
+/* One round of Blake2b's compression function */
+#define ROUND_AVX2() \
+  do { \
+    G4(a, b, c, d); \
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1)); \
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2)); \
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(2, 1, 0, 3)); \
+    G4(a, b, c, d); \
+    b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3)); \
+    c = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(1, 0, 3, 2)); \
+    d = _mm256_permute4x64_epi64(d, _MM_SHUFFLE(0, 3, 2, 1)); \
+  } while(0)
+
+#define LOAD(p, k) _mm256_loadu_si256((const __m256i*)(p) + (k))
+#define STORE(p, k, x) _mm256_storeu_si256((__m256i*)(p) + (k), (x))
+
+#define LOAD_STATE(state) \
+    __m256i a = LOAD(state, 0); \
+    __m256i b = LOAD(state, 1); \
+    __m256i c = LOAD(state, 2); \
+    __m256i d = LOAD(state, 3)
+
+#define STORE_STATE(state) \
+  do { \
+    STORE(state, 0, a); \
+    STORE(state, 1, b); \
+    STORE(state, 2, c); \
+    STORE(state, 3, d); \
+  } while(0)
+
+/* Absorbs M[rowIn][col] [+] M[rowInOut][col] into the bitrate */
+#define ABSORB_SUM(in, inout) \
+  do { \
+    a = _mm256_xor_si256(a, _mm256_add_epi64(LOAD(in, 0), LOAD(inout, 0))); \
+    b = _mm256_xor_si256(b, _mm256_add_epi64(LOAD(in, 1), LOAD(inout, 1))); \
+    c = _mm256_xor_si256(c, _mm256_add_epi64(LOAD(in, 2), LOAD(inout, 2))); \
+  } while(0)
+
+/* M[out][col] = M[in][col] XOR rand */
+#define XOR_OUT(out, in) \
+  do { \
+    STORE(out, 0, _mm256_xor_si256(LOAD(in, 0), a)); \
+    STORE(out, 1, _mm256_xor_si256(LOAD(in, 1), b)); \
+    STORE(out, 2, _mm256_xor_si256(LOAD(in, 2), c)); \
+  } while(0)
+
+/* M[inout][col] = M[inout][col] XOR rotW(rand), with rotW(rand) = (rand[11], rand[0], ..., rand[10]) */
+#define XOR_ROTW(inout) \
+  do { \
+    __m256i ra = _mm256_permute4x64_epi64(a, _MM_SHUFFLE(2, 1, 0, 3)); \
+    __m256i rb = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3)); \
+    __m256i rc = _mm256_permute4x64_epi64(c, _MM_SHUFFLE(2, 1, 0, 3)); \
+    STORE(inout, 0, _mm256_xor_si256(LOAD(inout, 0), _mm256_blend_epi32(ra, rc, 0x03))); \
+    STORE(inout, 1, _mm256_xor_si256(LOAD(inout, 1), _mm256_blend_epi32(rb, ra, 0x03))); \
+    STORE(inout, 2, _mm256_xor_si256(LOAD(inout, 2), _mm256_blend_epi32(rc, rb, 0x03))); \
+  } while(0)
+
+static void blake2bLyra_avx2(uint64_t *v) {
+    int r;
+    LOAD_STATE(v);
+    for (r = 0; r < 12; r++) {
+        ROUND_AVX2();
+    }
+    STORE_STATE(v);
+}
+
+static void reducedSqueezeRow0_avx2(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+    uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
+    uint64_t i;
+    LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        //M[row][C-1-col] = H.reduced_squeeze()
+        STORE(ptrWord, 0, a);
+        STORE(ptrWord, 1, b);
+        STORE(ptrWord, 2, c);
+        ptrWord -= BLOCK_LEN_INT64;
+        ROUND_AVX2();
+    }
+    STORE_STATE(state);
+}
+
+static void reducedDuplexRow1_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        //Absorbing "M[prev][col]"
+        a = _mm256_xor_si256(a, LOAD(ptrWordIn, 0));
+        b = _mm256_xor_si256(b, LOAD(ptrWordIn, 1));
+        c = _mm256_xor_si256(c, LOAD(ptrWordIn, 2));
+        ROUND_AVX2();
+        //M[row][C-1-col] = M[prev][col] XOR rand
+        XOR_OUT(ptrWordOut, ptrWordIn);
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    STORE_STATE(state);
+}
+
+static void reducedDuplexRowSetup_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        ABSORB_SUM(ptrWordIn, ptrWordInOut);
+        ROUND_AVX2();
+        XOR_OUT(ptrWordOut, ptrWordIn);
+        XOR_ROTW(ptrWordInOut);
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    STORE_STATE(state);
+}
+
+static void reducedDuplexRow_avx2(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut;
+    uint64_t i;
+    LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        ABSORB_SUM(ptrWordIn, ptrWordInOut);
+        ROUND_AVX2();
+        //M[rowOut][col] = M[rowOut][col] XOR rand. rowOut may alias rowInOut, so
+        //this has to be stored before M[rowInOut][col] is reloaded below.
+        XOR_OUT(ptrWordOut, ptrWordOut);
+        XOR_ROTW(ptrWordInOut);
+        ptrWordOut += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+    }
+    STORE_STATE(state);
+}
+
+/*
+ * Four independent Lyra2 computations, one per 64-bit lane: every register
+ * below holds the same state or matrix word of four different inputs, so
+ * the code mirrors the generic implementation word by word. Only the
+ * wandering phase's pseudorandom row index differs between lanes; those rows
+ * are read and written through per-lane masks.
+ */
+
+/* Blake2b's G function on four lanes */
+#define G_4WAY(a, b, c, d) G4(v[a], v[b], v[c], v[d])
+
+/* One round of Blake2b's compression function on four lanes */
+#define ROUND_4WAY() \
+  do { \
+    G_4WAY(0, 4, 8, 12); \
+    G_4WAY(1, 5, 9, 13); \
+    G_4WAY(2, 6, 10, 14); \
+    G_4WAY(3, 7, 11, 15); \
+    G_4WAY(0, 5, 10, 15); \
+    G_4WAY(1, 6, 11, 12); \
+    G_4WAY(2, 7, 8, 13); \
+    G_4WAY(3, 4, 9, 14); \
+  } while(0)
+
+/* Word w of column col of the rows selected per lane by the masks sel[0..3] */
+static inline __m256i lyra2_4way_select(__m256i M[4][4][BLOCK_LEN_INT64], const __m256i sel[4], int col, int w) {
+    __m256i x = _mm256_and_si256(M[0][col][w], sel[0]);
+    x = _mm256_or_si256(x, _mm256_and_si256(M[1][col][w], sel[1]));
+    x = _mm256_or_si256(x, _mm256_and_si256(M[2][col][w], sel[2]));
+    return _mm256_or_si256(x, _mm256_and_si256(M[3][col][w], sel[3]));
+}
+
+/**
+ * Computes LYRA2_4x4(K[i], 32, pwd[i], 32, pwd[i], 32, 1) for i = 0..3, i.e. the
+ * Lyra2 step of Lyra2REv2 and Lyra2REc0ban for four inputs at once.
+ */
+static void lyra2_4x4_4way_avx2(void *const K[4], const void *const pwd[4]) {
+    ALIGN __m256i M[4][4][BLOCK_LEN_INT64];
+    __m256i v[16];
+    __m256i sel[4];
+    uint64_t in[4][4];
+    ALIGN uint64_t out[4][4];
+    int i, j, r, row, prev;
+
+    for (i = 0; i < 4; i++) {
+        memcpy(in[i], pwd[i], 32);
+    }
+
+    //Sponge state: zeros followed by Blake2b's IV
+    for (j = 0; j < 8; j++) {
+        v[j] = _mm256_setzero_si256();
+        v[j + 8] = _mm256_set1_epi64x(blake2b_IV[j]);
+    }
+
+    //Absorbs pad(pwd || salt || basil), with salt == pwd: two BLOCK_LEN_BLAKE2_SAFE_INT64 blocks
+    for (j = 0; j < 8; j++) {
+        v[j] = _mm256_xor_si256(v[j], _mm256_set_epi64x(in[3][j & 3], in[2][j & 3], in[1][j & 3], in[0][j & 3]));
+    }
+    for (r = 0; r < 12; r++) ROUND_4WAY();
+    v[0] = _mm256_xor_si256(v[0], _mm256_set1_epi64x(32)); //kLen
+    v[1] = _mm256_xor_si256(v[1], _mm256_set1_epi64x(32)); //pwdlen
+    v[2] = _mm256_xor_si256(v[2], _mm256_set1_epi64x(32)); //saltlen
+    v[3] = _mm256_xor_si256(v[3], _mm256_set1_epi64x(1)); //timeCost
+    v[4] = _mm256_xor_si256(v[4], _mm256_set1_epi64x(4)); //nRows
+    v[5] = _mm256_xor_si256(v[5], _mm256_set1_epi64x(4)); //nCols
+    v[6] = _mm256_xor_si256(v[6], _mm256_set1_epi64x(0x80));
+    v[7] = _mm256_xor_si256(v[7], _mm256_set1_epi64x(0x0100000000000000ULL));
+    for (r = 0; r < 12; r++) ROUND_4WAY();
+
+    //M[0][C-1-col] = H.reduced_squeeze()
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < BLOCK_LEN_INT64; j++) M[0][3 - i][j] = v[j];
+        ROUND_4WAY();
+    }
+
+    //M[1][C-1-col] = M[0][col] XOR rand
+    for (i = 0; i < 4; i++) {
+        for (j = 0; j < BLOCK_LEN_INT64; j++) v[j] = _mm256_xor_si256(v[j], M[0][i][j]);
+        ROUND_4WAY();
+        for (j = 0; j < BLOCK_LEN_INT64; j++) M[1][3 - i][j] = _mm256_xor_si256(M[0][i][j], v[j]);
+    }
+
+    //Setup: (prev, row*, row) = (1, 0, 2), then (2, 1, 3)
+    for (row = 2; row < 4; row++) {
+        const int rowIn = row - 1, rowInOut = row - 2;
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < BLOCK_LEN_INT64; j++) {
+                v[j] = _mm256_xor_si256(v[j], _mm256_add_epi64(M[rowIn][i][j], M[rowInOut][i][j]));
+            }
+            ROUND_4WAY();
+            for (j = 0; j < BLOCK_LEN_INT64; j++) {
+                M[row][3 - i][j] = _mm256_xor_si256(M[rowIn][i][j], v[j]);
+                M[rowInOut][i][j] = _mm256_xor_si256(M[rowInOut][i][j], v[(j + BLOCK_LEN_INT64 - 1) % BLOCK_LEN_INT64]);
+            }
+        }
+    }
+
+    //Wandering: row = 0, 1, 2, 3 with prev the row before it, and row* = state[0] % nRows per lane
+    prev = 3;
+    for (row = 0; row < 4; row++) {
+        __m256i rowa = _mm256_and_si256(v[0], _mm256_set1_epi64x(3));
+        for (r = 0; r < 4; r++) sel[r] = _mm256_cmpeq_epi64(rowa, _mm256_set1_epi64x(r));
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < BLOCK_LEN_INT64; j++) {
+                v[j] = _mm256_xor_si256(v[j], _mm256_add_epi64(M[prev][i][j], lyra2_4way_select(M, sel, i, j)));
+            }
+            ROUND_4WAY();
+            //M[row][col] ^= rand first, as row* may be the same row
+            for (j = 0; j < BLOCK_LEN_INT64; j++) M[row][i][j] = _mm256_xor_si256(M[row][i][j], v[j]);
+            for (j = 0; j < BLOCK_LEN_INT64; j++) {
+                __m256i rot = v[(j + BLOCK_LEN_INT64 - 1) % BLOCK_LEN_INT64];
+                for (r = 0; r < 4; r++) {
+                    M[r][i][j] = _mm256_xor_si256(M[r][i][j], _mm256_and_si256(rot, sel[r]));
+                }
+            }
+        }
+        prev = row;
+    }
+
+    //Wrap-up: absorbs M[row*][0] and squeezes the key
+    for (j = 0; j < BLOCK_LEN_INT64; j++) v[j] = _mm256_xor_si256(v[j], lyra2_4way_select(M, sel, 0, j));
+    for (r = 0; r < 12; r++) ROUND_4WAY();
+
+    for (j = 0; j < 4; j++) _mm256_store_si256((__m256i*)out[j], v[j]);
+    for (i = 0; i < 4; i++) {
+        uint64_t k[4] = {out[0][i], out[1][i], out[2][i], out[3][i]};
+        memcpy(K[i], k, 32);
+    }
+}
+
+const spongeImpl spongeImplAVX2 = {
+    "avx2",
+    blake2bLyra_avx2,
+    reducedSqueezeRow0_avx2,
+    reducedDuplexRow1_avx2,
+    reducedDuplexRowSetup_avx2,
+    reducedDuplexRow_avx2,
+    lyra2_4x4_4way_avx2
+};
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * SSE implementation of the Blake2b-based sponge used by Lyra2, shared by the
+ * SSE2 and SSSE3 variants. The including file must define SPONGE_ROTR24 and
+ * SPONGE_ROTR16 (64-bit rotations), SPONGE_ALIGNR64(hi, lo) (returning the high
+ * word of lo and the low word of hi) for its instruction set, and SPONGE_FN(name)
+ * to give the functions a unique name. The results are bit-identical to the
+ * generic implementation in Sponge.c.
+ *
+ * The 16-word sponge state is kept in eight 128-bit registers s0..s7, each
+ * holding two consecutive words; the 12-word bitrate is s0..s5.
+ *
+ * This software is hereby placed in the public domain.
+ */
+#ifndef SPONGE_SSE_H_
+#define SPONGE_SSE_H_
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include "Lyra2.h"
+
+#define SPONGE_ROTR32(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define SPONGE_ROTR63(x) _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+/* Half of Blake2b's G function applied to two columns (or diagonals) at once */
+#define SPONGE_G1(a0, a1, b0, b1, c0, c1, d0, d1) \
+  do { \
+    a0 = _mm_add_epi64(a0, b0); a1 = _mm_add_epi64(a1, b1); \
+    d0 = SPONGE_ROTR32(_mm_xor_si128(d0, a0)); d1 = SPONGE_ROTR32(_mm_xor_si128(d1, a1)); \
+    c0 = _mm_add_epi64(c0, d0); c1 = _mm_add_epi64(c1, d1); \
+    b0 = SPONGE_ROTR24(_mm_xor_si128(b0, c0)); b1 = SPONGE_ROTR24(_mm_xor_si128(b1, c1)); \
+  } while(0)
+
+#define SPONGE_G2(a0, a1, b0, b1, c0, c1, d0, d1) \
+  do { \
+    a0 = _mm_add_epi64(a0, b0); a1 = _mm_add_epi64(a1, b1); \
+    d0 = SPONGE_ROTR16(_mm_xor_si128(d0, a0)); d1 = SPONGE_ROTR16(_mm_xor_si128(d1, a1)); \
+    c0 = _mm_add_epi64(c0, d0); c1 = _mm_add_epi64(c1, d1); \
+    b0 = SPONGE_ROTR63(_mm_xor_si128(b0, c0)); b1 = SPONGE_ROTR63(_mm_xor_si128(b1, c1)); \
+  } while(0)
+
+/* Rotates the words of the 4-word row (x0, x1) left by one: (x0, x1) = ((w1, w2), (w3, w0)) */
+#define SPONGE_ROTL_ROW(x0, x1) \
+  do { \
+    __m128i t0_ = x0; \
+    x0 = _mm_unpackhi_epi64(x0, _mm_unpacklo_epi64(x1, x1)); \
+    x1 = _mm_unpackhi_epi64(x1, _mm_unpacklo_epi64(t0_, t0_)); \
+  } while(0)
+
+/* Rotates the words of the 4-word row (x0, x1) right by one: (x0, x1) = ((w3, w0), (w1, w2)) */
+#define SPONGE_ROTR_ROW(x0, x1) \
+  do { \
+    __m128i t0_ = x0; \
+    x0 = _mm_unpackhi_epi64(x1, _mm_unpacklo_epi64(x0, x0)); \
+    x1 = _mm_unpackhi_epi64(t0_, _mm_unpacklo_epi64(x1, x1)); \
+  } while(0)
+
+/* One round of Blake2b's compression function over the state s0..s7 */
+#define SPONGE_ROUND() \
+  do { \
+    __m128i t_; \
+    SPONGE_G1(s0, s1, s2, s3, s4, s5, s6, s7); \
+    SPONGE_G2(s0, s1, s2, s3, s4, s5, s6, s7); \
+    SPONGE_ROTL_ROW(s2, s3); \
+    t_ = s4; s4 = s5; s5 = t_; \
+    SPONGE_ROTR_ROW(s6, s7); \
+    SPONGE_G1(s0, s1, s2, s3, s4, s5, s6, s7); \
+    SPONGE_G2(s0, s1, s2, s3, s4, s5, s6, s7); \
+    SPONGE_ROTR_ROW(s2, s3); \
+    t_ = s4; s4 = s5; s5 = t_; \
+    SPONGE_ROTL_ROW(s6, s7); \
+  } while(0)
+
+#define SPONGE_LOAD_STATE(state) \
+    __m128i s0 = _mm_loadu_si128((const __m128i*)(state) + 0); \
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(state) + 1); \
+    __m128i s2 = _mm_loadu_si128((const __m128i*)(state) + 2); \
+    __m128i s3 = _mm_loadu_si128((const __m128i*)(state) + 3); \
+    __m128i s4 = _mm_loadu_si128((const __m128i*)(state) + 4); \
+    __m128i s5 = _mm_loadu_si128((const __m128i*)(state) + 5); \
+    __m128i s6 = _mm_loadu_si128((const __m128i*)(state) + 6); \
+    __m128i s7 = _mm_loadu_si128((const __m128i*)(state) + 7)
+
+#define SPONGE_STORE_STATE(state) \
+  do { \
+    _mm_storeu_si128((__m128i*)(state) + 0, s0); \
+    _mm_storeu_si128((__m128i*)(state) + 1, s1); \
+    _mm_storeu_si128((__m128i*)(state) + 2, s2); \
+    _mm_storeu_si128((__m128i*)(state) + 3, s3); \
+    _mm_storeu_si128((__m128i*)(state) + 4, s4); \
+    _mm_storeu_si128((__m128i*)(state) + 5, s5); \
+    _mm_storeu_si128((__m128i*)(state) + 6, s6); \
+    _mm_storeu_si128((__m128i*)(state) + 7, s7); \
+  } while(0)
+
+#define SPONGE_LOAD(p, k) _mm_loadu_si128((const __m128i*)(p) + (k))
+#define SPONGE_STORE(p, k, x) _mm_storeu_si128((__m128i*)(p) + (k), (x))
+
+/* Absorbs M[rowIn][col] [+] M[rowInOut][col] into the bitrate */
+#define SPONGE_ABSORB_SUM(in, inout) \
+  do { \
+    s0 = _mm_xor_si128(s0, _mm_add_epi64(SPONGE_LOAD(in, 0), SPONGE_LOAD(inout, 0))); \
+    s1 = _mm_xor_si128(s1, _mm_add_epi64(SPONGE_LOAD(in, 1), SPONGE_LOAD(inout, 1))); \
+    s2 = _mm_xor_si128(s2, _mm_add_epi64(SPONGE_LOAD(in, 2), SPONGE_LOAD(inout, 2))); \
+    s3 = _mm_xor_si128(s3, _mm_add_epi64(SPONGE_LOAD(in, 3), SPONGE_LOAD(inout, 3))); \
+    s4 = _mm_xor_si128(s4, _mm_add_epi64(SPONGE_LOAD(in, 4), SPONGE_LOAD(inout, 4))); \
+    s5 = _mm_xor_si128(s5, _mm_add_epi64(SPONGE_LOAD(in, 5), SPONGE_LOAD(inout, 5))); \
+  } while(0)
+
+/* M[out][col] = M[in][col] XOR rand */
+#define SPONGE_XOR_OUT(out, in) \
+  do { \
+    SPONGE_STORE(out, 0, _mm_xor_si128(SPONGE_LOAD(in, 0), s0)); \
+    SPONGE_STORE(out, 1, _mm_xor_si128(SPONGE_LOAD(in, 1), s1)); \
+    SPONGE_STORE(out, 2, _mm_xor_si128(SPONGE_LOAD(in, 2), s2)); \
+    SPONGE_STORE(out, 3, _mm_xor_si128(SPONGE_LOAD(in, 3), s3)); \
+    SPONGE_STORE(out, 4, _mm_xor_si128(SPONGE_LOAD(in, 4), s4)); \
+    SPONGE_STORE(out, 5, _mm_xor_si128(SPONGE_LOAD(in, 5), s5)); \
+  } while(0)
+
+/* M[inout][col] = M[inout][col] XOR rotW(rand) */
+#define SPONGE_XOR_ROTW(inout) \
+  do { \
+    SPONGE_STORE(inout, 0, _mm_xor_si128(SPONGE_LOAD(inout, 0), SPONGE_ALIGNR64(s0, s5))); \
+    SPONGE_STORE(inout, 1, _mm_xor_si128(SPONGE_LOAD(inout, 1), SPONGE_ALIGNR64(s1, s0))); \
+    SPONGE_STORE(inout, 2, _mm_xor_si128(SPONGE_LOAD(inout, 2), SPONGE_ALIGNR64(s2, s1))); \
+    SPONGE_STORE(inout, 3, _mm_xor_si128(SPONGE_LOAD(inout, 3), SPONGE_ALIGNR64(s3, s2))); \
+    SPONGE_STORE(inout, 4, _mm_xor_si128(SPONGE_LOAD(inout, 4), SPONGE_ALIGNR64(s4, s3))); \
+    SPONGE_STORE(inout, 5, _mm_xor_si128(SPONGE_LOAD(inout, 5), SPONGE_ALIGNR64(s5, s4))); \
+  } while(0)
+
+static void SPONGE_FN(blake2bLyra)(uint64_t *v) {
+    int r;
+    SPONGE_LOAD_STATE(v);
+    for (r = 0; r < 12; r++) {
+        SPONGE_ROUND();
+    }
+    SPONGE_STORE_STATE(v);
+}
+
+static void SPONGE_FN(reducedSqueezeRow0)(uint64_t* state, uint64_t* rowOut, uint64_t nCols) {
+    uint64_t* ptrWord = rowOut + (nCols-1)*BLOCK_LEN_INT64; //In Lyra2: pointer to M[0][C-1]
+    uint64_t i;
+    SPONGE_LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        //M[row][C-1-col] = H.reduced_squeeze()
+        SPONGE_STORE(ptrWord, 0, s0);
+        SPONGE_STORE(ptrWord, 1, s1);
+        SPONGE_STORE(ptrWord, 2, s2);
+        SPONGE_STORE(ptrWord, 3, s3);
+        SPONGE_STORE(ptrWord, 4, s4);
+        SPONGE_STORE(ptrWord, 5, s5);
+        ptrWord -= BLOCK_LEN_INT64;
+        SPONGE_ROUND();
+    }
+    SPONGE_STORE_STATE(state);
+}
+
+static void SPONGE_FN(reducedDuplexRow1)(uint64_t *state, uint64_t *rowIn, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    SPONGE_LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        //Absorbing "M[prev][col]"
+        s0 = _mm_xor_si128(s0, SPONGE_LOAD(ptrWordIn, 0));
+        s1 = _mm_xor_si128(s1, SPONGE_LOAD(ptrWordIn, 1));
+        s2 = _mm_xor_si128(s2, SPONGE_LOAD(ptrWordIn, 2));
+        s3 = _mm_xor_si128(s3, SPONGE_LOAD(ptrWordIn, 3));
+        s4 = _mm_xor_si128(s4, SPONGE_LOAD(ptrWordIn, 4));
+        s5 = _mm_xor_si128(s5, SPONGE_LOAD(ptrWordIn, 5));
+        SPONGE_ROUND();
+        //M[row][C-1-col] = M[prev][col] XOR rand
+        SPONGE_XOR_OUT(ptrWordOut, ptrWordIn);
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    SPONGE_STORE_STATE(state);
+}
+
+static void SPONGE_FN(reducedDuplexRowSetup)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordOut = rowOut + (nCols-1)*BLOCK_LEN_INT64;
+    uint64_t i;
+    SPONGE_LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        SPONGE_ABSORB_SUM(ptrWordIn, ptrWordInOut);
+        SPONGE_ROUND();
+        SPONGE_XOR_OUT(ptrWordOut, ptrWordIn);
+        SPONGE_XOR_ROTW(ptrWordInOut);
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+        ptrWordOut -= BLOCK_LEN_INT64;
+    }
+    SPONGE_STORE_STATE(state);
+}
+
+static void SPONGE_FN(reducedDuplexRow)(uint64_t *state, uint64_t *rowIn, uint64_t *rowInOut, uint64_t *rowOut, uint64_t nCols) {
+    uint64_t* ptrWordInOut = rowInOut;
+    uint64_t* ptrWordIn = rowIn;
+    uint64_t* ptrWordOut = rowOut;
+    uint64_t i;
+    SPONGE_LOAD_STATE(state);
+    for (i = 0; i < nCols; i++) {
+        SPONGE_ABSORB_SUM(ptrWordIn, ptrWordInOut);
+        SPONGE_ROUND();
+        //M[rowOut][col] = M[rowOut][col] XOR rand. rowOut may alias rowInOut, so
+        //this has to be stored before M[rowInOut][col] is reloaded below.
+        SPONGE_XOR_OUT(ptrWordOut, ptrWordOut);
+        SPONGE_XOR_ROTW(ptrWordInOut);
+        ptrWordOut += BLOCK_LEN_INT64;
+        ptrWordInOut += BLOCK_LEN_INT64;
+        ptrWordIn += BLOCK_LEN_INT64;
+    }
+    SPONGE_STORE_STATE(state);
+}
+
+#endif /* SPONGE_SSE_H_ */
@@ -0,0 +1,31 @@
+/**
+ * SSE2 implementation of the Blake2b-based sponge used by Lyra2.
+ *
+ * This software is hereby placed in the public domain.
+ */
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include "Sponge.h"
+
+#if defined(USE_ASM) && defined(__SSE2__)
+
+#define SPONGE_ROTR24(x) _mm_or_si128(_mm_srli_epi64((x), 24), _mm_slli_epi64((x), 40))
+#define SPONGE_ROTR16(x) _mm_shufflehi_epi16(_mm_shufflelo_epi16((x), _MM_SHUFFLE(0, 3, 2, 1)), _MM_SHUFFLE(0, 3, 2, 1))
+#define SPONGE_ALIGNR64(hi, lo) _mm_unpackhi_epi64((lo), _mm_slli_si128((hi), 8))
+#define SPONGE_FN(name) name##_sse2
+
+#include "Sponge_sse.h"
+
+const spongeImpl spongeImplSSE2 = {
+    "sse2",
+    blake2bLyra_sse2,
+    reducedSqueezeRow0_sse2,
+    reducedDuplexRow1_sse2,
+    reducedDuplexRowSetup_sse2,
+    reducedDuplexRow_sse2,
+    NULL
+};
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * SSSE3 implementation of the Blake2b-based sponge used by Lyra2. Identical to
+ * the SSE2 version except that byte shuffles are used for the 24 and 16 bit
+ * rotations and for rotW.
+ *
+ * This software is hereby placed in the public domain.
+ */
+#ifdef ENABLE_SSSE3
+
+#include "Sponge.h"
+
+#include <tmmintrin.h>
+
+#define SPONGE_ROTR24(x) _mm_shuffle_epi8((x), _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define SPONGE_ROTR16(x) _mm_shuffle_epi8((x), _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+#define SPONGE_ALIGNR64(hi, lo) _mm_alignr_epi8((hi), (lo), 8)
+#define SPONGE_FN(name) name##_ssse3
+
+#include "Sponge_sse.h"
+
+const spongeImpl spongeImplSSSE3 = {
+    "ssse3",
+    blake2bLyra_ssse3,
+    reducedSqueezeRow0_ssse3,
+    reducedDuplexRow1_ssse3,
+    reducedDuplexRowSetup_ssse3,
+    reducedDuplexRow_ssse3,
+    NULL
+};
+
+#endif
@@ -689,9 +689,17 @@ bmw32_close(sph_bmw_small_context *sc, unsigned ub, unsigned n,
 		h = h1;
 	}
 	memset(buf + ptr, 0, (sizeof sc->buf) - 8 - ptr);
+	/*
+	 * compress_small() reads the buffer as 32-bit words, so the bit
+	 * count is written as two 32-bit words as well: a single 64-bit
+	 * store breaks strict aliasing and lets the compiler reorder it
+	 * after the reads.
+	 */
 #if SPH_64
-	sph_enc64le_aligned(buf + (sizeof sc->buf) - 8,
-		SPH_T64(sc->bit_count + n));
+	sph_enc32le_aligned(buf + (sizeof sc->buf) - 8,
+		SPH_T32(sc->bit_count + n));
+	sph_enc32le_aligned(buf + (sizeof sc->buf) - 4,
+		SPH_T32((sc->bit_count + n) >> 32));
 #else
 	sph_enc32le_aligned(buf + (sizeof sc->buf) - 8,
 		sc->bit_count_low + n);
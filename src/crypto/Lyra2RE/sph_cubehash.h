@@ -37,6 +37,10 @@
 #ifndef SPH_CUBEHASH_H__
 #define SPH_CUBEHASH_H__
 
+#ifdef __cplusplus
+extern "C"{
+#endif
+
 #include <stddef.h>
 #include "sph_types.h"
 
@@ -282,5 +286,9 @@ void sph_cubehash512_close(void *cc, void *dst);
 void sph_cubehash512_addbits_and_close(
 	void *cc, unsigned ub, unsigned n, void *dst);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
 
@@ -0,0 +1,246 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/muhash.h>
+
+#include <crypto/chacha20.h>
+#include <crypto/sha256.h>
+#include <uint256.h>
+
+#include <limits>
+
+namespace {
+
+typedef Num3072::limb_t limb_t;
+typedef Num3072::double_limb_t double_limb_t;
+const int LIMBS = Num3072::LIMBS;
+const int LIMB_SIZE = Num3072::LIMB_SIZE;
+const limb_t LIMB_MAX = std::numeric_limits<limb_t>::max();
+
+/** The modulus is 2^3072 - MAX_PRIME_DIFF, so 2^3072 is congruent to MAX_PRIME_DIFF. */
+const limb_t MAX_PRIME_DIFF = 1103717;
+
+/** Add n to the number in limbs, returning the carry out of the top limb. */
+double_limb_t AddSmall(limb_t* limbs, double_limb_t n)
+{
+    for (int i = 0; i < LIMBS && n != 0; ++i) {
+        n += limbs[i];
+        limbs[i] = (limb_t)n;
+        n >>= LIMB_SIZE;
+    }
+    return n;
+}
+
+} // namespace
+
+Num3072::Num3072()
+{
+    limbs[0] = 1;
+    for (int i = 1; i < LIMBS; ++i) limbs[i] = 0;
+}
+
+Num3072::Num3072(const unsigned char (&data)[BYTE_SIZE])
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        limbs[i] = 0;
+        for (int j = LIMB_SIZE / 8 - 1; j >= 0; --j) {
+            limbs[i] = (limbs[i] << 8) | data[i * (LIMB_SIZE / 8) + j];
+        }
+    }
+    if (IsOverflow()) FullReduce();
+}
+
+void Num3072::ToBytes(unsigned char (&out)[BYTE_SIZE]) const
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        for (int j = 0; j < LIMB_SIZE / 8; ++j) {
+            out[i * (LIMB_SIZE / 8) + j] = (unsigned char)(limbs[i] >> (8 * j));
+        }
+    }
+}
+
+bool Num3072::operator==(const Num3072& other) const
+{
+    for (int i = 0; i < LIMBS; ++i) {
+        if (limbs[i] != other.limbs[i]) return false;
+    }
+    return true;
+}
+
+bool Num3072::IsOverflow() const
+{
+    if (limbs[0] <= LIMB_MAX - MAX_PRIME_DIFF) return false;
+    for (int i = 1; i < LIMBS; ++i) {
+        if (limbs[i] != LIMB_MAX) return false;
+    }
+    return true;
+}
+
+void Num3072::FullReduce()
+{
+    // x - (2^3072 - MAX_PRIME_DIFF), where the 2^3072 is the carry that is dropped
+    AddSmall(limbs, MAX_PRIME_DIFF);
+}
+
+void Num3072::Multiply(const Num3072& a)
+{
+    // Schoolbook product, into twice the limbs
+    limb_t product[2 * LIMBS] = {};
+    for (int i = 0; i < LIMBS; ++i) {
+        limb_t carry = 0;
+        for (int j = 0; j < LIMBS; ++j) {
+            const double_limb_t t = (double_limb_t)limbs[i] * a.limbs[j] + product[i + j] + carry;
+            product[i + j] = (limb_t)t;
+            carry = t >> LIMB_SIZE;
+        }
+        product[i + LIMBS] = carry;
+    }
+
+    // low + high * 2^3072 is congruent to low + high * MAX_PRIME_DIFF, which leaves a carry
+    // below 2^21. Folding that in the same way overflows at most once more, into a number so
+    // small that adding MAX_PRIME_DIFF for the overflow cannot overflow again.
+    limb_t carry = 0;
+    for (int i = 0; i < LIMBS; ++i) {
+        const double_limb_t t = (double_limb_t)product[LIMBS + i] * MAX_PRIME_DIFF + product[i] + carry;
+        limbs[i] = (limb_t)t;
+        carry = t >> LIMB_SIZE;
+    }
+    if (AddSmall(limbs, (double_limb_t)carry * MAX_PRIME_DIFF) != 0) {
+        AddSmall(limbs, MAX_PRIME_DIFF);
+    }
+    if (IsOverflow()) FullReduce();
+}
+
+Num3072 Num3072::GetInverse() const
+{
+    // Binary extended Euclid on (x, p), keeping u == x1 * x and v == x2 * x modulo p until
+    // u or v reaches one. That takes a few thousand additions and shifts, which is much
+    // less work than exponentiating by p - 2, as finalizing is done for every block by the
+    // coinstats index.
+    limb_t u[LIMBS], v[LIMBS], x1[LIMBS], x2[LIMBS], p[LIMBS];
+    bool zero = true;
+    for (int i = 0; i < LIMBS; ++i) {
+        u[i] = limbs[i];
+        zero = zero && limbs[i] == 0;
+        p[i] = v[i] = i == 0 ? LIMB_MAX - MAX_PRIME_DIFF + 1 : LIMB_MAX;
+        x1[i] = i == 0 ? 1 : 0;
+        x2[i] = 0;
+    }
+    Num3072 out;
+    if (zero) {
+        // Zero has no inverse; it only comes up if a hashed element maps to zero
+        out.limbs[0] = 0;
+        return out;
+    }
+
+    const auto is_one = [](const limb_t* a) {
+        if (a[0] != 1) return false;
+        for (int i = 1; i < LIMBS; ++i) {
+            if (a[i] != 0) return false;
+        }
+        return true;
+    };
+    // a += b, returning the carry
+    const auto add = [](limb_t* a, const limb_t* b) {
+        limb_t carry = 0;
+        for (int i = 0; i < LIMBS; ++i) {
+            const double_limb_t t = (double_limb_t)a[i] + b[i] + carry;
+            a[i] = (limb_t)t;
+            carry = t >> LIMB_SIZE;
+        }
+        return carry;
+    };
+    // a -= b, returning the borrow
+    const auto sub = [](limb_t* a, const limb_t* b) {
+        limb_t borrow = 0;
+        for (int i = 0; i < LIMBS; ++i) {
+            const limb_t bi = b[i] + borrow;
+            borrow = (bi < borrow) | (a[i] < bi);
+            a[i] -= bi;
+        }
+        return borrow;
+    };
+    // a = (a + top * 2^3072) / 2
+    const auto halve = [](limb_t* a, limb_t top) {
+        for (int i = 0; i < LIMBS - 1; ++i) {
+            a[i] = (a[i] >> 1) | (a[i + 1] << (LIMB_SIZE - 1));
+        }
+        a[LIMBS - 1] = (a[LIMBS - 1] >> 1) | (top << (LIMB_SIZE - 1));
+    };
+    // a = a / 2 modulo p
+    const auto halve_mod = [&](limb_t* a) {
+        halve(a, (a[0] & 1) ? add(a, p) : 0);
+    };
+    const auto not_below = [](const limb_t* a, const limb_t* b) {
+        for (int i = LIMBS - 1; i >= 0; --i) {
+            if (a[i] != b[i]) return a[i] > b[i];
+        }
+        return true;
+    };
+
+    while (!is_one(u) && !is_one(v)) {
+        while (!(u[0] & 1)) {
+            halve(u, 0);
+            halve_mod(x1);
+        }
+        while (!(v[0] & 1)) {
+            halve(v, 0);
+            halve_mod(x2);
+        }
+        if (not_below(u, v)) {
+            sub(u, v);
+            if (sub(x1, x2)) add(x1, p);
+        } else {
+            sub(v, u);
+            if (sub(x2, x1)) add(x2, p);
+        }
+    }
+    const limb_t* result = is_one(u) ? x1 : x2;
+    for (int i = 0; i < LIMBS; ++i) out.limbs[i] = result[i];
+    return out;
+}
+
+Num3072 MuHash3072::ToNum3072(const unsigned char* data, size_t len)
+{
+    unsigned char hash[CSHA256::OUTPUT_SIZE];
+    CSHA256().Write(data, len).Finalize(hash);
+    unsigned char bytes[Num3072::BYTE_SIZE];
+    ChaCha20(hash, sizeof(hash)).Keystream(bytes, sizeof(bytes));
+    return Num3072(bytes);
+}
+
+MuHash3072& MuHash3072::Insert(const unsigned char* data, size_t len)
+{
+    m_numerator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::Remove(const unsigned char* data, size_t len)
+{
+    m_denominator.Multiply(ToNum3072(data, len));
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator*=(const MuHash3072& mul)
+{
+    m_numerator.Multiply(mul.m_numerator);
+    m_denominator.Multiply(mul.m_denominator);
+    return *this;
+}
+
+MuHash3072& MuHash3072::operator/=(const MuHash3072& div)
+{
+    m_numerator.Multiply(div.m_denominator);
+    m_denominator.Multiply(div.m_numerator);
+    return *this;
+}
+
+void MuHash3072::Finalize(uint256& out) const
+{
+    Num3072 value = m_numerator;
+    value.Multiply(m_denominator.GetInverse());
+    unsigned char bytes[Num3072::BYTE_SIZE];
+    value.ToBytes(bytes);
+    CSHA256().Write(bytes, sizeof(bytes)).Finalize(out.begin());
+}
@@ -0,0 +1,105 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_MUHASH_H
+#define BITCOIN_CRYPTO_MUHASH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+class uint256;
+
+/** A number modulo 2^3072 - 1103717, the largest 3072-bit safe prime, kept fully reduced. */
+class Num3072
+{
+public:
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef unsigned __int128 double_limb_t;
+    typedef uint64_t limb_t;
+    static const int LIMBS = 48;
+    static const int LIMB_SIZE = 64;
+#else
+    typedef uint64_t double_limb_t;
+    typedef uint32_t limb_t;
+    static const int LIMBS = 96;
+    static const int LIMB_SIZE = 32;
+#endif
+    static const size_t BYTE_SIZE = 384;
+
+    //! Little-endian limbs
+    limb_t limbs[LIMBS];
+
+    //! The number one
+    Num3072();
+    //! The number whose little-endian encoding is data, reduced
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void Multiply(const Num3072& a);
+    Num3072 GetInverse() const;
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+    bool operator==(const Num3072& other) const;
+
+private:
+    //! Whether the number is not below the modulus
+    bool IsOverflow() const;
+    //! Subtract the modulus from a number that is not below it
+    void FullReduce();
+};
+
+/**
+ * A hash of a set of byte strings, the MuHash of "A New Paradigm for Collision-free Hashing:
+ * Incrementality at Reduced Cost" (Bellare, Micciancio). Every element maps to a number
+ * modulo a 3072-bit prime, and the set to the product of those numbers, so the hash does not
+ * depend on the order elements are inserted in, and the hashes of disjoint sets combine by
+ * multiplying them: a large set can be hashed in parts, in parallel. Removing an element
+ * divides by its number; divisions are collected and done once, when finalizing.
+ *
+ * An element maps to the 384 byte ChaCha20 keystream keyed with its SHA256.
+ */
+class MuHash3072
+{
+private:
+    Num3072 m_numerator;
+    Num3072 m_denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    /** The hash of the empty set. */
+    MuHash3072() {}
+
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    /** Add the elements hashed by mul, giving the hash of the union of disjoint sets. */
+    MuHash3072& operator*=(const MuHash3072& mul);
+    /** Take away the elements hashed by div, which must be in this set. */
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /** The 256-bit digest of the set. The object remains untouched. */
+    void Finalize(uint256& out) const;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char bytes[Num3072::BYTE_SIZE];
+        m_numerator.ToBytes(bytes);
+        s.write((const char*)bytes, sizeof(bytes));
+        m_denominator.ToBytes(bytes);
+        s.write((const char*)bytes, sizeof(bytes));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char bytes[Num3072::BYTE_SIZE];
+        s.read((char*)bytes, sizeof(bytes));
+        m_numerator = Num3072(bytes);
+        s.read((char*)bytes, sizeof(bytes));
+        m_denominator = Num3072(bytes);
+    }
+};
+
+#endif // BITCOIN_CRYPTO_MUHASH_H
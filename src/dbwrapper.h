@@ -12,6 +12,8 @@
 #include <util/system.h>
 #include <util/strencodings.h>
 
+#include <memory>
+
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
@@ -118,15 +120,18 @@ class CDBIterator
 private:
     const CDBWrapper &parent;
     leveldb::Iterator *piter;
+    //! The snapshot piter reads, if any, kept until piter is gone
+    std::shared_ptr<const leveldb::Snapshot> snapshot;
 
 public:
 
     /**
      * @param[in] _parent          Parent CDBWrapper instance.
      * @param[in] _piter           The original leveldb iterator.
+     * @param[in] _snapshot        The snapshot the iterator reads, if any.
      */
-    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter) :
-        parent(_parent), piter(_piter) { };
+    CDBIterator(const CDBWrapper &_parent, leveldb::Iterator *_piter, std::shared_ptr<const leveldb::Snapshot> _snapshot = nullptr) :
+        parent(_parent), piter(_piter), snapshot(std::move(_snapshot)) { };
     ~CDBIterator();
 
     bool Valid() const;
@@ -309,6 +314,23 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Take a snapshot of the database, which is released with its last reference. Iterators
+     * over a snapshot all see the database as it was then, whatever is written after.
+     */
+    std::shared_ptr<const leveldb::Snapshot> GetSnapshot()
+    {
+        leveldb::DB* db = pdb;
+        return std::shared_ptr<const leveldb::Snapshot>(pdb->GetSnapshot(), [db](const leveldb::Snapshot* snapshot) { db->ReleaseSnapshot(snapshot); });
+    }
+
+    CDBIterator *NewIterator(const std::shared_ptr<const leveldb::Snapshot>& snapshot)
+    {
+        leveldb::ReadOptions options = iteroptions;
+        options.snapshot = snapshot.get();
+        return new CDBIterator(*this, pdb->NewIterator(options), snapshot);
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
@@ -84,6 +84,9 @@ protected:
 
     virtual DB& GetDB() const = 0;
 
+    /// The last block the index has been synced to, or null.
+    const CBlockIndex* CurrentIndex() const { return m_best_block_index.load(); }
+
     /// Get the name of the index for display in logs.
     virtual const char* GetName() const = 0;
 
@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_COINSTATSINDEX_H
+#define BITCOIN_INDEX_COINSTATSINDEX_H
+
+#include <amount.h>
+#include <chain.h>
+#include <crypto/muhash.h>
+#include <index/base.h>
+
+struct CCoinsStats;
+
+static const bool DEFAULT_COINSTATSINDEX = false;
+
+/**
+ * CoinStatsIndex keeps the statistics of the UTXO set (the MuHash of the coins, their count,
+ * bogosize and total amount) as of every block. It updates them as blocks connect, adding the
+ * outputs a block creates and removing the coins it spends, which its undo data has, and undoes
+ * that when blocks are disconnected, so gettxoutsetinfo does not need to scan the chainstate.
+ *
+ * Like the block filter index, the statistics of blocks on the active chain are stored by height,
+ * and those of blocks that have been reorganized out of it by block hash.
+ */
+class CoinStatsIndex final : public BaseIndex
+{
+private:
+    std::string m_name;
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+    //! The statistics as of the best block of the index
+    MuHash3072 m_muhash;
+    uint64_t m_transaction_output_count{0};
+    uint64_t m_bogo_size{0};
+    CAmount m_total_amount{0};
+
+    //! Undo the changes of a block on the best block of the index to the statistics
+    bool ReverseBlock(const CBlock& block, const CBlockIndex* pindex);
+
+protected:
+    bool Init() override;
+
+    bool CommitInternal(CDBBatch& batch) override;
+
+    bool WriteBlock(const CBlock& block, const CBlockIndex* pindex) override;
+
+    bool Rewind(const CBlockIndex* current_tip, const CBlockIndex* new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+    const char* GetName() const override { return m_name.c_str(); }
+
+public:
+    /** Constructs the index, which becomes available to be queried. */
+    explicit CoinStatsIndex(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /** Look up the statistics of the UTXO set as of a block. The hash is the MuHash of the coins. */
+    bool LookupStats(const CBlockIndex* block_index, CCoinsStats& stats) const;
+};
+
+/** The global UTXO set statistics index. May be null. */
+extern std::unique_ptr<CoinStatsIndex> g_coin_stats_index;
+
+#endif // BITCOIN_INDEX_COINSTATSINDEX_H
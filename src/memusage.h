@@ -6,6 +6,7 @@
 #define BITCOIN_MEMUSAGE_H
 
 #include <indirectmap.h>
+#include <pooledmap.h>
 #include <prevector.h>
 
 #include <stdlib.h>
@@ -119,6 +120,16 @@ static inline size_t IncrementalDynamicUsage(const std::map<X, Y, Z>& m)
     return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y> >));
 }
 
+// pooledmap allocates its elements in chunks, next to a flat index
+
+template<typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const pooledmap<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(typename pooledmap<X, Y, Z>::chunk_type)) * m.chunk_count() +
+           MallocUsage(sizeof(void*) * m.chunk_count()) +
+           MallocUsage(sizeof(typename pooledmap<X, Y, Z>::slot_type) * m.slot_count());
+}
+
 // indirectmap has underlying map with pointer as key
 
 template<typename X, typename Y>
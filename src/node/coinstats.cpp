@@ -5,69 +5,207 @@
 
 #include <node/coinstats.h>
 
+#include <checkqueue.h>
 #include <coins.h>
+#include <crypto/muhash.h>
 #include <hash.h>
 #include <serialize.h>
+#include <streams.h>
+#include <txdb.h>
 #include <validation.h>
 #include <uint256.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <map>
 
-static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
+//! The number of parts the coins are split into, by the first byte of their txid, to compute their statistics in parallel
+static const int COINS_STATS_SHARDS = 256;
+//! The most coins a queued check reads, so that it only holds up a worker for milliseconds
+static const size_t COINS_STATS_CHUNK = 1000;
+
+uint64_t GetBogoSize(const CScript& script_pub_key)
+{
+    return 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
+           2 /* scriptPubKey len */ + script_pub_key.size() /* scriptPubKey */;
+}
+
+static CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin)
+{
+    CDataStream ss(SER_DISK, PROTOCOL_VERSION);
+    ss << outpoint;
+    ss << uint32_t(coin.nHeight * 2 + coin.fCoinBase);
+    ss << coin.out;
+    return ss;
+}
+
+void InsertCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin)
+{
+    const CDataStream ss = TxOutSer(outpoint, coin);
+    muhash.Insert((const unsigned char*)ss.data(), ss.size());
+}
+
+void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin)
+{
+    const CDataStream ss = TxOutSer(outpoint, coin);
+    muhash.Remove((const unsigned char*)ss.data(), ss.size());
+}
+
+static void ApplyStats(CCoinsStats &stats, CHashWriter* ss, MuHash3072* muhash, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
     assert(!outputs.empty());
-    ss << hash;
-    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase ? 1u : 0u);
+    if (ss) {
+        *ss << hash;
+        *ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase ? 1u : 0u);
+    }
     stats.nTransactions++;
     for (const auto& output : outputs) {
-        ss << VARINT(output.first + 1);
-        ss << output.second.out.scriptPubKey;
-        ss << VARINT_MODE(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
+        if (ss) {
+            *ss << VARINT(output.first + 1);
+            *ss << output.second.out.scriptPubKey;
+            *ss << VARINT_MODE(output.second.out.nValue, VarIntMode::NONNEGATIVE_SIGNED);
+        }
+        if (muhash) InsertCoinHash(*muhash, COutPoint(hash, output.first), output.second);
         stats.nTransactionOutputs++;
         stats.nTotalAmount += output.second.out.nValue;
-        stats.nBogoSize += 32 /* txid */ + 4 /* vout index */ + 4 /* height + coinbase */ + 8 /* amount */ +
-                           2 /* scriptPubKey len */ + output.second.out.scriptPubKey.size() /* scriptPubKey */;
+        stats.nBogoSize += GetBogoSize(output.second.out.scriptPubKey);
     }
-    ss << VARINT(0u);
+    if (ss) *ss << VARINT(0u);
 }
 
+/**
+ * The statistics of the coins of one cursor, which are combined with those of the other shards
+ * afterwards. Only the counts and amounts of stats are set. The coins are read in chunks, and the
+ * outputs of the last txid read are kept until the next chunk, which may have more of them.
+ */
+class CCoinsStatsShard
+{
+private:
+    CCoinsViewCursor* m_cursor;
+    CCoinsStats* m_stats;
+    CHashWriter* m_ss;
+    MuHash3072* m_muhash;
+    uint256 m_prevkey;
+    std::map<uint32_t, Coin> m_outputs;
+
+public:
+    CCoinsStatsShard(CCoinsViewCursor* cursor, CCoinsStats* stats, CHashWriter* ss, MuHash3072* muhash) :
+        m_cursor(cursor), m_stats(stats), m_ss(ss), m_muhash(muhash) {}
+
+    //! Read up to max_coins more coins, or all of them if it is zero. Returns false on a read error.
+    bool Read(size_t max_coins) {
+        for (size_t n = 0; m_cursor->Valid() && (max_coins == 0 || n < max_coins); ++n) {
+            COutPoint key;
+            Coin coin;
+            if (m_cursor->GetKey(key) && m_cursor->GetValue(coin)) {
+                if (!m_outputs.empty() && key.hash != m_prevkey) {
+                    ApplyStats(*m_stats, m_ss, m_muhash, m_prevkey, m_outputs);
+                    m_outputs.clear();
+                }
+                m_prevkey = key.hash;
+                m_outputs[key.n] = std::move(coin);
+                m_stats->coins_count++;
+            } else {
+                return error("%s: unable to read value", __func__);
+            }
+            m_cursor->Next();
+        }
+        if (!m_cursor->Valid() && !m_outputs.empty()) {
+            ApplyStats(*m_stats, m_ss, m_muhash, m_prevkey, m_outputs);
+            m_outputs.clear();
+        }
+        return true;
+    }
+
+    bool Done() const { return !m_cursor->Valid(); }
+};
+
+/** Closure representing reading the next chunk of the coins of a shard. */
+class CCoinsStatsChunk
+{
+private:
+    CCoinsStatsShard* m_shard{nullptr};
+
+public:
+    CCoinsStatsChunk() {}
+    explicit CCoinsStatsChunk(CCoinsStatsShard* shard) : m_shard(shard) {}
+
+    bool operator()() {
+        return m_shard->Read(COINS_STATS_CHUNK);
+    }
+
+    void swap(CCoinsStatsChunk& chunk) {
+        std::swap(m_shard, chunk.m_shard);
+    }
+};
+
+static CCheckQueue<CCoinsStatsChunk> coinsstatsqueue(1, &ValidationPool(), VALIDATION_PRIORITY_STATS);
+
 //! Calculate statistics about the unspent transaction output set
-bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
+bool GetUTXOStats(CCoinsViewDB *view, CCoinsStats &stats, CoinStatsHashType hash_type)
 {
     stats = CCoinsStats();
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
-    assert(pcursor);
+    // The serialized hash covers the coins in order, so it is computed from one cursor; the
+    // other kinds split the coins into shards, which go through the script check threads.
+    const bool sharded = hash_type != CoinStatsHashType::HASH_SERIALIZED;
+    const std::vector<std::unique_ptr<CCoinsViewCursor>> cursors = view->Cursors(sharded ? COINS_STATS_SHARDS : 1);
+    if (cursors.empty()) {
+        return error("%s: the coins database has no best block; a write to it was interrupted", __func__);
+    }
 
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
-    stats.hashBlock = pcursor->GetBestBlock();
+    stats.hashBlock = cursors[0]->GetBestBlock();
     {
         LOCK(cs_main);
         stats.nHeight = LookupBlockIndex(stats.hashBlock)->nHeight;
     }
     ss << stats.hashBlock;
-    uint256 prevkey;
-    std::map<uint32_t, Coin> outputs;
-    while (pcursor->Valid()) {
-        COutPoint key;
-        Coin coin;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            if (!outputs.empty() && key.hash != prevkey) {
-                ApplyStats(stats, ss, prevkey, outputs);
-                outputs.clear();
-            }
-            prevkey = key.hash;
-            outputs[key.n] = std::move(coin);
-            stats.coins_count++;
-        } else {
-            return error("%s: unable to read value", __func__);
+
+    std::vector<CCoinsStats> shard_stats(cursors.size());
+    std::vector<MuHash3072> shard_muhashes(hash_type == CoinStatsHashType::MUHASH ? cursors.size() : 0);
+    std::vector<CCoinsStatsShard> shards;
+    shards.reserve(cursors.size());
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        shards.emplace_back(cursors[i].get(), &shard_stats[i], sharded ? nullptr : &ss, shard_muhashes.empty() ? nullptr : &shard_muhashes[i]);
+    }
+    if (sharded && g_parallel_script_checks) {
+        // Queue a chunk of each shard at a time, so that block validation never waits long for
+        // a worker, and queue the next chunks of the unfinished shards once those are read.
+        std::vector<CCoinsStatsShard*> pending;
+        for (CCoinsStatsShard& shard : shards) pending.push_back(&shard);
+        while (!pending.empty()) {
+            CCheckQueueControl<CCoinsStatsChunk> control(&coinsstatsqueue);
+            std::vector<CCoinsStatsChunk> chunks;
+            for (CCoinsStatsShard* shard : pending) chunks.emplace_back(shard);
+            control.Add(chunks);
+            if (!control.Wait()) return false;
+            pending.erase(std::remove_if(pending.begin(), pending.end(), [](const CCoinsStatsShard* shard) { return shard->Done(); }), pending.end());
+        }
+    } else {
+        for (CCoinsStatsShard& shard : shards) {
+            if (!shard.Read(0)) return false;
         }
-        pcursor->Next();
     }
-    if (!outputs.empty()) {
-        ApplyStats(stats, ss, prevkey, outputs);
+
+    MuHash3072 muhash;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        stats.nTransactions += shard_stats[i].nTransactions;
+        stats.nTransactionOutputs += shard_stats[i].nTransactionOutputs;
+        stats.nBogoSize += shard_stats[i].nBogoSize;
+        stats.nTotalAmount += shard_stats[i].nTotalAmount;
+        stats.coins_count += shard_stats[i].coins_count;
+        if (!shard_muhashes.empty()) muhash *= shard_muhashes[i];
+    }
+    switch (hash_type) {
+    case CoinStatsHashType::HASH_SERIALIZED:
+        stats.hashSerialized = ss.GetHash();
+        break;
+    case CoinStatsHashType::MUHASH:
+        muhash.Finalize(stats.hashSerialized);
+        break;
+    case CoinStatsHashType::NONE:
+        break;
     }
-    stats.hashSerialized = ss.GetHash();
     stats.nDiskSize = view->EstimateSize();
     return true;
 }
@@ -11,7 +11,20 @@
 
 #include <cstdint>
 
-class CCoinsView;
+class CCoinsViewDB;
+class Coin;
+class COutPoint;
+class CScript;
+class MuHash3072;
+
+enum class CoinStatsHashType {
+    //! The hash of all coins serialized in order, on one thread
+    HASH_SERIALIZED,
+    //! A MuHash3072 of the coins, computed in parallel
+    MUHASH,
+    //! No hash; the statistics are computed in parallel
+    NONE,
+};
 
 struct CCoinsStats
 {
@@ -20,15 +33,26 @@ struct CCoinsStats
     uint64_t nTransactions{0};
     uint64_t nTransactionOutputs{0};
     uint64_t nBogoSize{0};
+    //! The hash of the kind asked for, or null for CoinStatsHashType::NONE
     uint256 hashSerialized{};
     uint64_t nDiskSize{0};
     CAmount nTotalAmount{0};
 
     //! The number of coins contained.
     uint64_t coins_count{0};
+
+    //! Whether the statistics come from the coinstats index, which does not count transactions or disk size
+    bool index_used{false};
 };
 
+//! The bogosize of a coin with this scriptPubKey, see CCoinsStats::nBogoSize
+uint64_t GetBogoSize(const CScript& script_pub_key);
+
+//! Add a coin to, or remove it from, a MuHash of the UTXO set as computed by GetUTXOStats
+void InsertCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
+void RemoveCoinHash(MuHash3072& muhash, const COutPoint& outpoint, const Coin& coin);
+
 //! Calculate statistics about the unspent transaction output set
-bool GetUTXOStats(CCoinsView* view, CCoinsStats& stats);
+bool GetUTXOStats(CCoinsViewDB* view, CCoinsStats& stats, CoinStatsHashType hash_type = CoinStatsHashType::HASH_SERIALIZED);
 
 #endif // BITCOIN_NODE_COINSTATS_H
@@ -0,0 +1 @@
+#define BUILD_SUFFIX e373e6a-dirty
@@ -0,0 +1,347 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POOLEDMAP_H
+#define BITCOIN_POOLEDMAP_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/* Hash map for large numbers of small elements, such as the coins cache.
+ *
+ * Elements are allocated from a pool in chunks of CHUNK_SIZE rather than one
+ * by one, and are found through a flat open-addressing index (linear probing)
+ * of 8 bytes per slot, which holds 32 bits of the element's hash next to its
+ * position in the pool. Compared to a std::unordered_map this saves the list
+ * pointer and the allocation overhead of every element, and a lookup mostly
+ * touches the index instead of chasing pointers.
+ *
+ * Elements never move, so references and iterators to an element stay valid
+ * until it is erased, as with std::unordered_map. Iteration is in pool order.
+ * erase() returns the iterator to the next element, so elements can be erased
+ * while iterating.
+ *
+ * The hash function must return well mixed bits (like SipHash does), as only
+ * 32 of them are used, and the low ones of those pick the slot.
+ */
+template <typename K, typename T, typename Hash>
+class pooledmap
+{
+public:
+    typedef K key_type;
+    typedef T mapped_type;
+    typedef std::pair<const K, T> value_type;
+    typedef size_t size_type;
+
+private:
+    //! Elements per chunk of the pool
+    static const size_t CHUNK_SIZE = 16;
+
+    union Node {
+        value_type value;
+        //! For a free node, the position of the next free node
+        uint32_t next_free;
+        Node() {}
+        ~Node() {}
+    };
+
+    struct Chunk {
+        //! Bit i is set if nodes[i] holds an element
+        uint32_t live{0};
+        Node nodes[CHUNK_SIZE];
+    };
+    static_assert(CHUNK_SIZE <= 32, "live bits must fit in Chunk::live");
+
+    struct Slot {
+        //! 32 bits of the element's hash; the low bits are the slot it belongs in
+        uint32_t hash;
+        //! One plus the element's position in the pool, or zero if the slot is empty
+        uint32_t pos;
+    };
+
+    static const size_t NPOS = std::numeric_limits<size_t>::max();
+    static const uint32_t NO_FREE = std::numeric_limits<uint32_t>::max();
+    //! The smallest non-empty index
+    static const size_t MIN_SLOTS = 8;
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    std::vector<Slot> m_slots;
+    size_t m_size{0};
+    //! Positions below this have been used
+    uint32_t m_used{0};
+    //! Head of the list of free positions below m_used
+    uint32_t m_free{NO_FREE};
+    Hash m_hash;
+
+    uint32_t HashKey(const K& key) const
+    {
+        const uint64_t hash = m_hash(key);
+        return uint32_t(hash) ^ uint32_t(hash >> 32);
+    }
+
+    Chunk& ChunkAt(size_t pos) const { return *m_chunks[pos / CHUNK_SIZE]; }
+    Node& NodeAt(size_t pos) const { return ChunkAt(pos).nodes[pos % CHUNK_SIZE]; }
+
+    /** The position of the first element at or after pos, or NPOS. */
+    size_t NextLive(size_t pos) const
+    {
+        size_t chunk = pos / CHUNK_SIZE;
+        if (chunk >= m_chunks.size()) return NPOS;
+        uint32_t live = m_chunks[chunk]->live & (~uint32_t{0} << (pos % CHUNK_SIZE));
+        while (live == 0) {
+            if (++chunk == m_chunks.size()) return NPOS;
+            live = m_chunks[chunk]->live;
+        }
+        return chunk * CHUNK_SIZE + CountTrailingZeros(live);
+    }
+
+    static unsigned int CountTrailingZeros(uint32_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctz(x);
+#else
+        unsigned int n = 0;
+        while (!(x & 1)) {
+            x >>= 1;
+            ++n;
+        }
+        return n;
+#endif
+    }
+
+    /** Take a position in the pool for a new element. */
+    uint32_t AllocNode()
+    {
+        if (m_free != NO_FREE) {
+            const uint32_t pos = m_free;
+            m_free = NodeAt(pos).next_free;
+            return pos;
+        }
+        assert(m_used < NO_FREE - 1);
+        if (m_used == m_chunks.size() * CHUNK_SIZE) {
+            m_chunks.emplace_back(new Chunk());
+        }
+        return m_used++;
+    }
+
+    void FreeNode(uint32_t pos)
+    {
+        NodeAt(pos).next_free = m_free;
+        m_free = pos;
+    }
+
+    /** Put an element in the first empty slot of its probe sequence. */
+    static void PlaceSlot(std::vector<Slot>& slots, const Slot& slot)
+    {
+        const size_t mask = slots.size() - 1;
+        size_t i = slot.hash & mask;
+        while (slots[i].pos != 0) i = (i + 1) & mask;
+        slots[i] = slot;
+    }
+
+    /** Make the index large enough for n elements, keeping it at most 3/4 full. */
+    void ReserveSlots(size_t n)
+    {
+        if (n * 4 <= m_slots.size() * 3) return;
+        size_t count = m_slots.empty() ? MIN_SLOTS : m_slots.size() * 2;
+        while (n * 4 > count * 3) count *= 2;
+        std::vector<Slot> slots(count, Slot{0, 0});
+        for (const Slot& slot : m_slots) {
+            if (slot.pos != 0) PlaceSlot(slots, slot);
+        }
+        m_slots.swap(slots);
+    }
+
+    /** Find the slot of key, or the empty slot where it would go. */
+    size_t FindSlot(const K& key, uint32_t hash) const
+    {
+        const size_t mask = m_slots.size() - 1;
+        size_t i = hash & mask;
+        while (m_slots[i].pos != 0 && (m_slots[i].hash != hash || NodeAt(m_slots[i].pos - 1).value.first != key)) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    /** Empty slot i, moving later slots of the same cluster back so lookups still find them. */
+    void EraseSlot(size_t i)
+    {
+        const size_t mask = m_slots.size() - 1;
+        for (size_t j = (i + 1) & mask; m_slots[j].pos != 0; j = (j + 1) & mask) {
+            // The element in slot j can fill the hole if the hole is between where it belongs and j
+            const size_t home = m_slots[j].hash & mask;
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                m_slots[i] = m_slots[j];
+                i = j;
+            }
+        }
+        m_slots[i] = Slot{0, 0};
+    }
+
+    template <bool Const>
+    class Iterator
+    {
+    private:
+        friend class pooledmap;
+        typedef typename std::conditional<Const, const pooledmap, pooledmap>::type map_type;
+        map_type* m_map{nullptr};
+        size_t m_pos{NPOS};
+        Iterator(map_type* map, size_t pos) : m_map(map), m_pos(pos) {}
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef typename pooledmap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type, value_type>::type* pointer;
+        typedef typename std::conditional<Const, const value_type, value_type>::type& reference;
+
+        Iterator() {}
+        template <bool OtherConst, typename = typename std::enable_if<Const || !OtherConst>::type>
+        Iterator(const Iterator<OtherConst>& other) : m_map(other.m_map), m_pos(other.m_pos) {}
+
+        reference operator*() const { return m_map->NodeAt(m_pos).value; }
+        pointer operator->() const { return &m_map->NodeAt(m_pos).value; }
+        Iterator& operator++() { m_pos = m_map->NextLive(m_pos + 1); return *this; }
+        Iterator operator++(int) { Iterator copy(*this); ++*this; return copy; }
+        template <bool OtherConst>
+        bool operator==(const Iterator<OtherConst>& other) const { return m_pos == other.m_pos; }
+        template <bool OtherConst>
+        bool operator!=(const Iterator<OtherConst>& other) const { return m_pos != other.m_pos; }
+
+        template <bool OtherConst> friend class Iterator;
+    };
+
+public:
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+    //! Exposed for memory usage accounting
+    typedef Chunk chunk_type;
+    typedef Slot slot_type;
+
+    pooledmap() {}
+    pooledmap(const pooledmap&) = delete;
+    pooledmap& operator=(const pooledmap&) = delete;
+    ~pooledmap() { clear(); }
+
+    iterator begin() { return iterator(this, NextLive(0)); }
+    const_iterator begin() const { return const_iterator(this, NextLive(0)); }
+    iterator end() { return iterator(this, NPOS); }
+    const_iterator end() const { return const_iterator(this, NPOS); }
+
+    size_type size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    //! The number of chunks in the pool
+    size_t chunk_count() const { return m_chunks.size(); }
+    //! The number of slots in the index
+    size_t slot_count() const { return m_slots.size(); }
+
+    iterator find(const K& key)
+    {
+        if (m_size == 0) return end();
+        const size_t i = FindSlot(key, HashKey(key));
+        return iterator(this, m_slots[i].pos != 0 ? m_slots[i].pos - 1 : NPOS);
+    }
+
+    const_iterator find(const K& key) const
+    {
+        return const_cast<pooledmap*>(this)->find(key);
+    }
+
+    size_type count(const K& key) const { return find(key) != end(); }
+
+    /** Insert an element constructed from args for key if there is none yet. */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args)
+    {
+        ReserveSlots(m_size + 1);
+        const uint32_t hash = HashKey(key);
+        const size_t i = FindSlot(key, hash);
+        if (m_slots[i].pos != 0) return {iterator(this, m_slots[i].pos - 1), false};
+
+        const uint32_t pos = AllocNode();
+        try {
+            new (&NodeAt(pos).value) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        } catch (...) {
+            FreeNode(pos);
+            throw;
+        }
+        ChunkAt(pos).live |= uint32_t{1} << (pos % CHUNK_SIZE);
+        m_slots[i] = Slot{hash, pos + 1};
+        ++m_size;
+        return {iterator(this, pos), true};
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(const K& key, Args&&... args)
+    {
+        return try_emplace(key, std::forward<Args>(args)...);
+    }
+
+    T& operator[](const K& key) { return try_emplace(key).first->second; }
+
+    /** Erase an element, returning the iterator to the next one. */
+    iterator erase(const_iterator it)
+    {
+        const uint32_t pos = it.m_pos;
+        value_type& value = NodeAt(pos).value;
+        const uint32_t hash = HashKey(value.first);
+        const size_t mask = m_slots.size() - 1;
+        size_t i = hash & mask;
+        while (m_slots[i].pos != pos + 1) i = (i + 1) & mask;
+        EraseSlot(i);
+
+        value.~value_type();
+        ChunkAt(pos).live &= ~(uint32_t{1} << (pos % CHUNK_SIZE));
+        FreeNode(pos);
+        --m_size;
+        return iterator(this, NextLive(pos + 1));
+    }
+
+    size_type erase(const K& key)
+    {
+        const iterator it = find(key);
+        if (it == end()) return 0;
+        erase(it);
+        return 1;
+    }
+
+    /** Exchange the elements, and the hash functions, of two maps. */
+    void swap(pooledmap& other)
+    {
+        m_chunks.swap(other.m_chunks);
+        m_slots.swap(other.m_slots);
+        std::swap(m_size, other.m_size);
+        std::swap(m_used, other.m_used);
+        std::swap(m_free, other.m_free);
+        std::swap(m_hash, other.m_hash);
+    }
+
+    /** Erase all elements and give back the pool. The index keeps its size, as a std::unordered_map keeps its buckets. */
+    void clear()
+    {
+        for (auto& chunk : m_chunks) {
+            for (size_t i = 0; i < CHUNK_SIZE; ++i) {
+                if (chunk->live & (uint32_t{1} << i)) chunk->nodes[i].value.~value_type();
+            }
+        }
+        m_chunks.clear();
+        m_chunks.shrink_to_fit();
+        std::fill(m_slots.begin(), m_slots.end(), Slot{0, 0});
+        m_size = 0;
+        m_used = 0;
+        m_free = NO_FREE;
+    }
+};
+
+#endif // BITCOIN_POOLEDMAP_H
@@ -16,8 +16,12 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <primitives/block.h>
+#include <sync.h>
 #include <uint256.h>
 
+#include <deque>
+#include <vector>
+
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock,
                                  const Consensus::Params& params)
 {
@@ -64,6 +68,150 @@ unsigned int LwmaGetNextWorkRequired(const CBlockIndex* pindexLast, const CBlock
     }
 }
 
+namespace {
+
+/**
+ * The LWMA averaging window: the N blocks ending at some tip, with the sums both LWMA variants
+ * compute from it. Advancing the tip by one block updates the sums in constant time, so the
+ * difficulty of successive blocks (header sync, connecting blocks, getblocktemplate) does not
+ * walk the window with GetAncestor every time. Any other tip change, such as a reorg or a
+ * header on a side chain, rebuilds the window by walking pprev.
+ *
+ * Entries hold values rather than CBlockIndex pointers, and the window is keyed by the tip's
+ * block hash, so it stays valid if the block index is unloaded and loaded again.
+ */
+class LwmaWindow
+{
+public:
+    struct Sums {
+        //! LWMA: sum of j * solvetime_j for j = 1..N, solvetimes clamped to [-FTL, 6T]
+        int64_t weighted_solvetimes;
+        //! LWMA-1: sum of j * solvetime_j with solvetimes capped at 6T; only used if increasing
+        int64_t weighted_capped_solvetimes;
+        //! Whether every block in the window is newer than its parent
+        bool increasing;
+        //! Sum of target_j / (k * N)
+        arith_uint256 target_sum;
+    };
+
+    /** Sums of the window ending at pindexLast. Requires pindexLast->nHeight >= N. */
+    Sums Get(const CBlockIndex* pindexLast, const Consensus::Params& params) LOCKS_EXCLUDED(m_mutex)
+    {
+        const int64_t N = Params().AveragingWindow();
+        assert(pindexLast->nHeight >= N);
+
+        // Blocks built in tests may not have a hash; there is nothing to key the window on.
+        if (!pindexLast->phashBlock) {
+            LwmaWindow window;
+            window.Rebuild(pindexLast, params, N);
+            return window.m_sums;
+        }
+
+        LOCK(m_mutex);
+        const bool same_window = m_params == &params && static_cast<int64_t>(m_entries.size()) == N;
+        if (!same_window || m_tip_hash != pindexLast->GetBlockHash()) {
+            if (same_window && pindexLast->pprev->phashBlock && m_tip_hash == pindexLast->pprev->GetBlockHash()) {
+                Advance(pindexLast, params, N);
+            } else {
+                Rebuild(pindexLast, params, N);
+            }
+            m_params = &params;
+            m_tip_hash = pindexLast->GetBlockHash();
+        }
+        return m_sums;
+    }
+
+private:
+    struct Entry {
+        int64_t solvetime; //!< Block time minus the parent's block time, unclamped
+        arith_uint256 scaled_target;
+    };
+
+    static int64_t Clamped(int64_t solvetime, const Consensus::Params& params)
+    {
+        // LWMA works on int solvetimes
+        const int FTL = MAX_FUTURE_BLOCK_TIME;
+        const int T = params.nPowTargetSpacing;
+        return std::max(-FTL, std::min(static_cast<int>(solvetime), 6 * T));
+    }
+
+    static int64_t Capped(int64_t solvetime, const Consensus::Params& params)
+    {
+        return std::min(solvetime, 6 * params.nPowTargetSpacing);
+    }
+
+    static Entry MakeEntry(const CBlockIndex* block, const Consensus::Params& params, int64_t N)
+    {
+        const int64_t k = N * (N + 1) * params.nPowTargetSpacing / 2;
+        arith_uint256 target;
+        target.SetCompact(block->nBits);
+        return Entry{block->GetBlockTime() - block->pprev->GetBlockTime(), target / (k * N)};
+    }
+
+    /** Append the entry of the block after the newest one, with the given weight. */
+    void Add(const Entry& entry, int64_t weight, const Consensus::Params& params)
+    {
+        m_sums.weighted_solvetimes += weight * Clamped(entry.solvetime, params);
+        m_sums.weighted_capped_solvetimes += weight * Capped(entry.solvetime, params);
+        m_sum_solvetimes += Clamped(entry.solvetime, params);
+        m_sum_capped_solvetimes += Capped(entry.solvetime, params);
+        if (entry.solvetime <= 0) ++m_non_increasing;
+        m_sums.target_sum += entry.scaled_target;
+        m_sums.increasing = m_non_increasing == 0;
+        m_entries.push_back(entry);
+    }
+
+    /** Drop the oldest entry. Every remaining entry moves down one weight. */
+    void RemoveOldest(const Consensus::Params& params)
+    {
+        const Entry& oldest = m_entries.front();
+        m_sums.weighted_solvetimes -= m_sum_solvetimes;
+        m_sums.weighted_capped_solvetimes -= m_sum_capped_solvetimes;
+        m_sum_solvetimes -= Clamped(oldest.solvetime, params);
+        m_sum_capped_solvetimes -= Capped(oldest.solvetime, params);
+        if (oldest.solvetime <= 0) --m_non_increasing;
+        m_sums.target_sum -= oldest.scaled_target;
+        m_sums.increasing = m_non_increasing == 0;
+        m_entries.pop_front();
+    }
+
+    void Advance(const CBlockIndex* pindexLast, const Consensus::Params& params, int64_t N)
+    {
+        RemoveOldest(params);
+        Add(MakeEntry(pindexLast, params, N), N, params);
+    }
+
+    void Rebuild(const CBlockIndex* pindexLast, const Consensus::Params& params, int64_t N)
+    {
+        std::vector<Entry> entries;
+        entries.reserve(N);
+        for (const CBlockIndex* block = pindexLast; static_cast<int64_t>(entries.size()) < N; block = block->pprev) {
+            entries.push_back(MakeEntry(block, params, N));
+        }
+        m_entries.clear();
+        m_sums = Sums{0, 0, true, arith_uint256()};
+        m_sum_solvetimes = m_sum_capped_solvetimes = 0;
+        m_non_increasing = 0;
+        // Oldest first: block j of the window has weight j
+        for (int64_t j = 1; j <= N; ++j) {
+            Add(entries[N - j], j, params);
+        }
+    }
+
+    Mutex m_mutex;
+    uint256 m_tip_hash;
+    const Consensus::Params* m_params{nullptr};
+    std::deque<Entry> m_entries;
+    Sums m_sums{0, 0, true, arith_uint256()};
+    int64_t m_sum_solvetimes{0};
+    int64_t m_sum_capped_solvetimes{0};
+    int m_non_increasing{0};
+};
+
+LwmaWindow g_lwma_window;
+
+} // namespace
+
 // refer to https://github.com/zawy12/difficulty-algorithms/issues/3#issuecomment-388386175
 // LWMA for BTC clones
 // Algorithm by zawy, LWMA idea by Tom Harding
@@ -79,28 +227,16 @@ unsigned int static LinearWeightedMovingAverage(const CBlockIndex* pindexLast, c
         return pindexLast->nBits;
     }
 
-    const int FTL = MAX_FUTURE_BLOCK_TIME;
     const int T = params.nPowTargetSpacing;
     const int N = Params().AveragingWindow();
     const int k = N*(N+1)*T/2;
     const int height = pindexLast->nHeight;
     assert(height > N);
 
-    arith_uint256 sum_target;
-    int t = 0, j = 0, solvetime;
-
-    // Loop through N most recent blocks.
-    for (int i = height - N+1; i <= height; i++) {
-        const CBlockIndex* block = pindexLast->GetAncestor(i);
-        const CBlockIndex* block_Prev = block->GetAncestor(i - 1);
-        solvetime = block->GetBlockTime() - block_Prev->GetBlockTime();
-        solvetime = std::max(-FTL, std::min(solvetime, 6*T));
-        j++;
-        t += solvetime * j;  // Weighted solvetime sum.
-        arith_uint256 target;
-        target.SetCompact(block->nBits);
-        sum_target += target / (k * N);
-    }
+    // Weighted solvetime sum and target sum of the N most recent blocks.
+    const LwmaWindow::Sums sums = g_lwma_window.Get(pindexLast, params);
+    int t = sums.weighted_solvetimes;
+    arith_uint256 sum_target = sums.target_sum;
 
     // Keep t reasonable to >= 1/10 of expected t.
     if (t < k/10 ) {
@@ -251,36 +387,45 @@ unsigned int Lwma1CalculateNextWorkRequired(const CBlockIndex* pindexLast, const
     }
 
     arith_uint256 avgTarget, nextTarget;
-    int64_t thisTimestamp, previousTimestamp;
-    int64_t sumWeightedSolvetimes = 0, j = 0;
+    int64_t sumWeightedSolvetimes = 0;
+
+    // While timestamps increase no solvetime needs adjusting, and the rolling window has both
+    // sums ready. Otherwise walk the window.
+    const LwmaWindow::Sums sums = g_lwma_window.Get(pindexLast, params);
+    if (sums.increasing) {
+        sumWeightedSolvetimes = sums.weighted_capped_solvetimes;
+        avgTarget = sums.target_sum;
+    } else {
+        int64_t thisTimestamp, previousTimestamp, j = 0;
 
-    const CBlockIndex* blockPreviousTimestamp = pindexLast->GetAncestor(height - N);
-    previousTimestamp = blockPreviousTimestamp->GetBlockTime();
+        const CBlockIndex* blockPreviousTimestamp = pindexLast->GetAncestor(height - N);
+        previousTimestamp = blockPreviousTimestamp->GetBlockTime();
 
-    // Loop through N most recent blocks.
-    for (int64_t i = height - N + 1; i <= height; i++) {
-        const CBlockIndex* block = pindexLast->GetAncestor(i);
+        // Loop through N most recent blocks.
+        for (int64_t i = height - N + 1; i <= height; i++) {
+            const CBlockIndex* block = pindexLast->GetAncestor(i);
 
-        // Prevent solvetimes from being negative in a safe way. It must be done like this.
-        // Do not attempt anything like  if (solvetime < 1) {solvetime=1;}
-        // The +1 ensures new coins do not calculate nextTarget = 0.
-        thisTimestamp = (block->GetBlockTime() > previousTimestamp) ?
-                            block->GetBlockTime() :
-                            previousTimestamp + 1;
+            // Prevent solvetimes from being negative in a safe way. It must be done like this.
+            // Do not attempt anything like  if (solvetime < 1) {solvetime=1;}
+            // The +1 ensures new coins do not calculate nextTarget = 0.
+            thisTimestamp = (block->GetBlockTime() > previousTimestamp) ?
+                                block->GetBlockTime() :
+                                previousTimestamp + 1;
 
-        // 6*T limit prevents large drops in diff from long solvetimes which would cause oscillations.
-        int64_t solvetime = std::min(6 * T, thisTimestamp - previousTimestamp);
+            // 6*T limit prevents large drops in diff from long solvetimes which would cause oscillations.
+            int64_t solvetime = std::min(6 * T, thisTimestamp - previousTimestamp);
 
-        // The following is part of "preventing negative solvetimes".
-        previousTimestamp = thisTimestamp;
+            // The following is part of "preventing negative solvetimes".
+            previousTimestamp = thisTimestamp;
 
-        // Give linearly higher weight to more recent solvetimes.
-        j++;
-        sumWeightedSolvetimes += solvetime * j;
+            // Give linearly higher weight to more recent solvetimes.
+            j++;
+            sumWeightedSolvetimes += solvetime * j;
 
-        arith_uint256 target;
-        target.SetCompact(block->nBits);
-        avgTarget += target / N / k; // Dividing by k here prevents an overflow below.
+            arith_uint256 target;
+            target.SetCompact(block->nBits);
+            avgTarget += target / N / k; // Dividing by k here prevents an overflow below.
+        }
     }
     nextTarget = avgTarget * sumWeightedSolvetimes;
 
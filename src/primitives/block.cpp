@@ -6,10 +6,20 @@
 
 #include <primitives/block.h>
 
+#include <crypto/Lyra2RE/Lyra2RE.h>
 #include <hash.h>
 #include <tinyformat.h>
 
-#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <assert.h>
+#include <new>
+
+static_assert(sizeof(lyra2_midstate) <= CBlockHeaderMidstate::MIDSTATE_SIZE && alignof(lyra2_midstate) <= 8, "CBlockHeaderMidstate storage too small for lyra2_midstate");
+static_assert(LYRA2_MIDSTATE_BYTES == 64, "CBlockHeaderMidstate documents a 64 byte midstate");
+
+static const lyra2_midstate* AsMidstate(const unsigned char* storage)
+{
+    return reinterpret_cast<const lyra2_midstate*>(storage);
+}
 
 #define BEGIN(a)            ((char*)&(a))
 
@@ -33,6 +43,73 @@ uint256 CBlockHeader::GetPoWHash(bool bLyra2REv2, bool bLyra2REvc0ban) const
     return GetHash();
 }
 
+void GetPoWHashBatch(Span<const CBlockHeader> headers, Span<uint256> out, bool bLyra2REv2, bool bLyra2REvc0ban)
+{
+    assert(out.size() >= headers.size());
+    std::ptrdiff_t i = 0;
+    if (bLyra2REv2) {
+        for (; i + 4 <= headers.size(); i += 4) {
+            const char* input[4];
+            char* output[4];
+            for (int j = 0; j < 4; ++j) {
+                input[j] = BEGIN(headers[i + j].nVersion);
+                output[j] = BEGIN(out[i + j]);
+            }
+            if (bLyra2REvc0ban) {
+                lyra2rec0ban_hash_4way(input, output);
+            } else {
+                lyra2re2_hash_4way(input, output);
+            }
+        }
+    }
+    for (; i < headers.size(); ++i) {
+        out[i] = headers[i].GetPoWHash(bLyra2REv2, bLyra2REvc0ban);
+    }
+}
+
+CBlockHeaderMidstate::CBlockHeaderMidstate(const CBlockHeader& header)
+{
+    lyra2_midstate_init(new (m_midstate) lyra2_midstate, BEGIN(header.nVersion));
+}
+
+uint256 CBlockHeaderMidstate::GetPoWHash(const CBlockHeader& header, bool bLyra2REv2, bool bLyra2REvc0ban) const
+{
+    if (!bLyra2REv2) {
+        return header.GetHash();
+    }
+    uint256 thash;
+    if (bLyra2REvc0ban) {
+        lyra2rec0ban_hash_midstate(AsMidstate(m_midstate), BEGIN(header.nVersion), BEGIN(thash));
+    } else {
+        lyra2re2_hash_midstate(AsMidstate(m_midstate), BEGIN(header.nVersion), BEGIN(thash));
+    }
+    return thash;
+}
+
+void CBlockHeaderMidstate::GetPoWHashBatch(Span<const CBlockHeader> headers, Span<uint256> out, bool bLyra2REv2, bool bLyra2REvc0ban) const
+{
+    assert(out.size() >= headers.size());
+    std::ptrdiff_t i = 0;
+    if (bLyra2REv2) {
+        for (; i + 4 <= headers.size(); i += 4) {
+            const char* input[4];
+            char* output[4];
+            for (int j = 0; j < 4; ++j) {
+                input[j] = BEGIN(headers[i + j].nVersion);
+                output[j] = BEGIN(out[i + j]);
+            }
+            if (bLyra2REvc0ban) {
+                lyra2rec0ban_hash_4way_midstate(AsMidstate(m_midstate), input, output);
+            } else {
+                lyra2re2_hash_4way_midstate(AsMidstate(m_midstate), input, output);
+            }
+        }
+    }
+    for (; i < headers.size(); ++i) {
+        out[i] = GetPoWHash(headers[i], bLyra2REv2, bLyra2REvc0ban);
+    }
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -9,6 +9,7 @@
 
 #include <primitives/transaction.h>
 #include <serialize.h>
+#include <span.h>
 #include <uint256.h>
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
@@ -72,6 +73,37 @@ public:
 };
 
 
+/**
+ * Compute headers[i].GetPoWHash(bLyra2REv2, bLyra2REvc0ban) into out[i] for all headers,
+ * hashing several headers at a time in parallel SIMD lanes where the CPU allows.
+ * out must be at least as large as headers.
+ */
+void GetPoWHashBatch(Span<const CBlockHeader> headers, Span<uint256> out, bool bLyra2REv2 = false, bool bLyra2REvc0ban = false);
+
+/**
+ * Proof-of-work hashing of headers that share their first 64 bytes and differ
+ * at most in the end of the merkle root, the time, the bits and the nonce, as while a miner rolls the
+ * nonce or time of a template. The Blake256 state over the shared bytes is computed once, up front.
+ */
+class CBlockHeaderMidstate
+{
+public:
+    explicit CBlockHeaderMidstate(const CBlockHeader& header);
+
+    /** header.GetPoWHash(bLyra2REv2, bLyra2REvc0ban) for a header sharing the midstate's leading bytes. */
+    uint256 GetPoWHash(const CBlockHeader& header, bool bLyra2REv2 = false, bool bLyra2REvc0ban = false) const;
+
+    /** GetPoWHashBatch for headers sharing the midstate's leading bytes. */
+    void GetPoWHashBatch(Span<const CBlockHeader> headers, Span<uint256> out, bool bLyra2REv2 = false, bool bLyra2REvc0ban = false) const;
+
+    //! Bytes of storage for the Blake256 midstate, which is opaque here to keep the sph headers out
+    static const size_t MIDSTATE_SIZE = 128;
+
+private:
+    //! A lyra2_midstate (see crypto/Lyra2RE/Lyra2RE.h)
+    alignas(8) unsigned char m_midstate[MIDSTATE_SIZE];
+};
+
 class CBlock : public CBlockHeader
 {
 public:
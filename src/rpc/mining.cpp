@@ -35,8 +35,10 @@
 #include <versionbitsinfo.h>
 #include <warnings.h>
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
+#include <thread>
 
 /**
  * Return average network hashes per second based on the last 'lookup' blocks,
@@ -102,7 +104,69 @@ static UniValue getnetworkhashps(const JSONRPCRequest& request)
     return GetNetworkHashPS(!request.params[0].isNull() ? request.params[0].get_int() : 120, !request.params[1].isNull() ? request.params[1].get_int() : -1);
 }
 
-static UniValue generateBlocks(const CTxMemPool& mempool, const CScript& coinbase_script, int nGenerate, uint64_t nMaxTries)
+/**
+ * Search the nonces of block, starting at its current nNonce, for one that satisfies its proof of
+ * work. At most max_tries nonces are tried, and max_tries is decreased by the number of nonces
+ * before the one found (or by all tried ones). The nonce space is split into runs that num_threads
+ * threads claim in order and hash in batches. Every run below the first valid nonce is fully
+ * searched, so the lowest valid nonce is found whatever the number of threads.
+ *
+ * On success block.nNonce holds the valid nonce. Otherwise it is the end of the searched range:
+ * std::numeric_limits<uint32_t>::max() once the nonce space is exhausted, as in a sequential search.
+ */
+static bool SearchNonce(CBlockHeader& block, uint64_t& max_tries, int num_threads, bool isPostFork, bool isPostForkLyra2C0ban, const Consensus::Params& params)
+{
+    static constexpr uint64_t NONCES_PER_RUN{16};
+
+    const uint64_t first_nonce = block.nNonce;
+    const uint64_t end_nonce = std::min<uint64_t>(std::numeric_limits<uint32_t>::max(), first_nonce + max_tries);
+    std::atomic<uint64_t> next_nonce{first_nonce};
+    std::atomic<bool> found{false};
+    Mutex cs_best;
+    uint64_t best_nonce = end_nonce;
+
+    // Only the nonce changes, so the Blake256 state over the leading header bytes is shared.
+    const CBlockHeaderMidstate midstate(block);
+
+    auto search = [&] {
+        std::vector<CBlockHeader> headers(NONCES_PER_RUN, block);
+        std::vector<uint256> hashes(NONCES_PER_RUN);
+        while (!found && !ShutdownRequested()) {
+            const uint64_t begin = next_nonce.fetch_add(NONCES_PER_RUN);
+            if (begin >= end_nonce) break;
+            const size_t count = std::min(NONCES_PER_RUN, end_nonce - begin);
+            for (size_t i = 0; i < count; ++i) {
+                headers[i].nNonce = begin + i;
+            }
+            midstate.GetPoWHashBatch(Span<const CBlockHeader>(headers.data(), count), Span<uint256>(hashes.data(), count), isPostFork, isPostForkLyra2C0ban);
+            for (size_t i = 0; i < count; ++i) {
+                if (CheckProofOfWork(hashes[i], block.nBits, isPostFork, params)) {
+                    LOCK(cs_best);
+                    best_nonce = std::min(best_nonce, begin + i);
+                    found = true;
+                    break;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_threads; ++i) {
+        threads.emplace_back(search);
+    }
+    search();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    LOCK(cs_best);
+    const uint64_t searched_end = found ? best_nonce : std::min(next_nonce.load(), end_nonce);
+    max_tries -= searched_end - first_nonce;
+    block.nNonce = searched_end;
+    return found;
+}
+
+static UniValue generateBlocks(const CTxMemPool& mempool, const CScript& coinbase_script, int nGenerate, uint64_t nMaxTries, int num_threads)
 {
     int nHeightEnd = 0;
     int nHeight = 0;
@@ -126,13 +190,7 @@ static UniValue generateBlocks(const CTxMemPool& mempool, const CScript& coinbas
         }
         bool isPostFork = nHeight+1 >= Params().SwitchLyra2REv2_LWMA();
         bool isPostForkLyra2C0ban = nHeight+1 >= Params().SwitchLyra2REvc0ban_LWMA();
-        // while (nMaxTries > 0 && pblock->nNonce < std::numeric_limits<uint32_t>::max() && !CheckProofOfWork(pblock->GetHash(), pblock->nBits, Params().GetConsensus()) && !ShutdownRequested()) {
-        while (nMaxTries > 0 && pblock->nNonce < std::numeric_limits<uint32_t>::max() 
-                && !CheckProofOfWork(pblock->GetPoWHash(isPostFork, isPostForkLyra2C0ban), pblock->nBits, isPostFork, Params().GetConsensus())
-                && !ShutdownRequested()) {
-            ++pblock->nNonce;
-            --nMaxTries;
-        }
+        SearchNonce(*pblock, nMaxTries, num_threads, isPostFork, isPostForkLyra2C0ban, Params().GetConsensus());
         if (nMaxTries == 0 || ShutdownRequested()) {
             break;
         }
@@ -148,6 +206,18 @@ static UniValue generateBlocks(const CTxMemPool& mempool, const CScript& coinbas
     return blockHashes;
 }
 
+/** Maximum number of threads the generate RPCs search nonces with */
+static constexpr int MAX_MINING_THREADS{64};
+
+static int ParseMiningThreads(const UniValue& param)
+{
+    const int num_threads = param.isNull() ? 1 : param.get_int();
+    if (num_threads < 1 || num_threads > MAX_MINING_THREADS) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("threads must be between 1 and %d", MAX_MINING_THREADS));
+    }
+    return num_threads;
+}
+
 static UniValue generatetodescriptor(const JSONRPCRequest& request)
 {
     RPCHelpMan{
@@ -157,6 +227,7 @@ static UniValue generatetodescriptor(const JSONRPCRequest& request)
             {"num_blocks", RPCArg::Type::NUM, RPCArg::Optional::NO, "How many blocks are generated immediately."},
             {"descriptor", RPCArg::Type::STR, RPCArg::Optional::NO, "The descriptor to send the newly generated bitcoin to."},
             {"maxtries", RPCArg::Type::NUM, /* default */ "1000000", "How many iterations to try."},
+            {"threads", RPCArg::Type::NUM, /* default */ "1", "How many threads to search nonces with."},
         },
         RPCResult{
             RPCResult::Type::ARR, "", "hashes of blocks generated",
@@ -171,6 +242,7 @@ static UniValue generatetodescriptor(const JSONRPCRequest& request)
 
     const int num_blocks{request.params[0].get_int()};
     const int64_t max_tries{request.params[2].isNull() ? 1000000 : request.params[2].get_int()};
+    const int num_threads{ParseMiningThreads(request.params[3])};
 
     FlatSigningProvider key_provider;
     std::string error;
@@ -192,7 +264,7 @@ static UniValue generatetodescriptor(const JSONRPCRequest& request)
 
     CHECK_NONFATAL(coinbase_script.size() == 1);
 
-    return generateBlocks(mempool, coinbase_script.at(0), num_blocks, max_tries);
+    return generateBlocks(mempool, coinbase_script.at(0), num_blocks, max_tries, num_threads);
 }
 
 static UniValue generatetoaddress(const JSONRPCRequest& request)
@@ -203,6 +275,7 @@ static UniValue generatetoaddress(const JSONRPCRequest& request)
                     {"nblocks", RPCArg::Type::NUM, RPCArg::Optional::NO, "How many blocks are generated immediately."},
                     {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address to send the newly generated c0ban to."},
                     {"maxtries", RPCArg::Type::NUM, /* default */ "1000000", "How many iterations to try."},
+                    {"threads", RPCArg::Type::NUM, /* default */ "1", "How many threads to search nonces with."},
                 },
                 RPCResult{
                     RPCResult::Type::ARR, "", "hashes of blocks generated",
@@ -222,6 +295,7 @@ static UniValue generatetoaddress(const JSONRPCRequest& request)
     if (!request.params[2].isNull()) {
         nMaxTries = request.params[2].get_int();
     }
+    const int num_threads = ParseMiningThreads(request.params[3]);
 
     CTxDestination destination = DecodeDestination(request.params[1].get_str());
     if (!IsValidDestination(destination)) {
@@ -232,7 +306,7 @@ static UniValue generatetoaddress(const JSONRPCRequest& request)
 
     CScript coinbase_script = GetScriptForDestination(destination);
 
-    return generateBlocks(mempool, coinbase_script, nGenerate, nMaxTries);
+    return generateBlocks(mempool, coinbase_script, nGenerate, nMaxTries, num_threads);
 }
 
 static UniValue getmininginfo(const JSONRPCRequest& request)
@@ -1042,8 +1116,8 @@ static const CRPCCommand commands[] =
     { "mining",             "submitheader",           &submitheader,           {"hexdata"} },
 
 
-    { "generating",         "generatetoaddress",      &generatetoaddress,      {"nblocks","address","maxtries"} },
-    { "generating",         "generatetodescriptor",   &generatetodescriptor,   {"num_blocks","descriptor","maxtries"} },
+    { "generating",         "generatetoaddress",      &generatetoaddress,      {"nblocks","address","maxtries","threads"} },
+    { "generating",         "generatetodescriptor",   &generatetodescriptor,   {"num_blocks","descriptor","maxtries","threads"} },
 
     { "util",               "estimatesmartfee",       &estimatesmartfee,       {"conf_target", "estimate_mode"} },
 
@@ -13,6 +13,7 @@
 #include <rpc/util.h>
 #include <scheduler.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
 #include <util/check.h>
 #include <util/message.h> // For MessageSign(), MessageVerify()
 #include <util/strencodings.h>
@@ -484,6 +485,36 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue getsigcacheinfo(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getsigcacheinfo",
+                "Returns statistics about the signature cache since startup.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "hits", "Number of signature checks answered from the cache"},
+                        {RPCResult::Type::NUM, "misses", "Number of signature checks not found in the cache"},
+                        {RPCResult::Type::NUM, "inserts", "Number of signatures added to the cache"},
+                        {RPCResult::Type::NUM, "evictions", "Number of inserts that pushed an entry out of the full cache"},
+                        {RPCResult::Type::NUM, "capacity", "Number of signatures the cache can hold"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getsigcacheinfo", "")
+            + HelpExampleRpc("getsigcacheinfo", "")
+                },
+            }.Check(request);
+
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+    UniValue obj(UniValue::VOBJ);
+    obj.pushKV("hits", stats.hits);
+    obj.pushKV("misses", stats.misses);
+    obj.pushKV("inserts", stats.inserts);
+    obj.pushKV("evictions", stats.evictions);
+    obj.pushKV("capacity", stats.capacity);
+    return obj;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -597,6 +628,7 @@ static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
+    { "control",            "getsigcacheinfo",        &getsigcacheinfo,        {} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
     { "util",               "createmultisig",         &createmultisig,         {"nrequired","keys","address_type"} },
@@ -8,6 +8,10 @@
 //
 // Implementing replay protection(such as when assigning ForkID at transaction signature) with reference to Bitcoin ABC and Bitcoin Gold.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <script/interpreter.h>
 
 #include <crypto/ripemd160.h>
@@ -15,8 +19,11 @@
 #include <crypto/sha256.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <streams.h>
 #include <uint256.h>
 
+#include <algorithm>
+
 typedef std::vector<unsigned char> valtype;
 
 namespace {
@@ -58,13 +65,104 @@ bool CastToBool(const valtype& vch)
  */
 #define stacktop(i)  (stack.at(stack.size()+(i)))
 #define altstacktop(i)  (altstack.at(altstack.size()+(i)))
+
+/**
+ * Memory of stack elements and stacks that went out of use, kept for reuse on
+ * the same thread. Script check threads evaluate one input after another, so
+ * after the first few inputs evaluating a script rarely needs the allocator.
+ */
+#if defined(HAVE_THREAD_LOCAL)
+static thread_local std::vector<valtype> g_spare_elements;
+static thread_local std::vector<std::vector<valtype>> g_spare_stacks;
+#endif
+static const size_t MAX_SPARE_ELEMENTS = 64;
+static const size_t MAX_SPARE_STACKS = 8;
+
+/** An empty element, in a recycled buffer if there is one. */
+static inline valtype NewElement()
+{
+#if defined(HAVE_THREAD_LOCAL)
+    if (!g_spare_elements.empty()) {
+        valtype vch = std::move(g_spare_elements.back());
+        g_spare_elements.pop_back();
+        return vch;
+    }
+#endif
+    return valtype();
+}
+
+static inline void RecycleElement(valtype& vch)
+{
+#if defined(HAVE_THREAD_LOCAL)
+    if (vch.capacity() != 0 && vch.capacity() <= MAX_SCRIPT_ELEMENT_SIZE && g_spare_elements.size() < MAX_SPARE_ELEMENTS) {
+        if (g_spare_elements.capacity() == 0) g_spare_elements.reserve(MAX_SPARE_ELEMENTS);
+        g_spare_elements.push_back(std::move(vch));
+    }
+#endif
+}
+
+/** Push a copy of [begin, end), which may point into the stack itself. */
+static inline void pushstack(std::vector<valtype>& stack, const unsigned char* begin, const unsigned char* end)
+{
+    valtype vch = NewElement();
+    vch.assign(begin, end);
+    stack.push_back(std::move(vch));
+}
+
+static inline void pushstack(std::vector<valtype>& stack, const valtype& vch)
+{
+    pushstack(stack, vch.data(), vch.data() + vch.size());
+}
+
 static inline void popstack(std::vector<valtype>& stack)
 {
     if (stack.empty())
         throw std::runtime_error("popstack(): stack empty");
+    RecycleElement(stack.back());
     stack.pop_back();
 }
 
+namespace {
+/** A stack whose memory is taken from, and handed back to, the spare buffers. */
+class PooledStack
+{
+public:
+    std::vector<valtype> stack;
+
+    PooledStack()
+    {
+#if defined(HAVE_THREAD_LOCAL)
+        if (!g_spare_stacks.empty()) {
+            stack = std::move(g_spare_stacks.back());
+            g_spare_stacks.pop_back();
+        }
+#endif
+    }
+
+    ~PooledStack()
+    {
+        for (valtype& vch : stack) RecycleElement(vch);
+#if defined(HAVE_THREAD_LOCAL)
+        if (stack.capacity() != 0 && stack.capacity() <= MAX_STACK_SIZE && g_spare_stacks.size() < MAX_SPARE_STACKS) {
+            stack.clear();
+            if (g_spare_stacks.capacity() == 0) g_spare_stacks.reserve(MAX_SPARE_STACKS);
+            g_spare_stacks.push_back(std::move(stack));
+        }
+#endif
+    }
+};
+
+/** An element buffer taken from, and handed back to, the spare buffers. */
+class PooledElement
+{
+public:
+    valtype vch;
+
+    PooledElement() : vch(NewElement()) {}
+    ~PooledElement() { RecycleElement(vch); }
+};
+} // namespace
+
 bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
     if (vchPubKey.size() < CPubKey::COMPRESSED_SIZE) {
         //  Non-canonical public key: too short
@@ -385,9 +483,11 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
     opcodetype opcode;
-    valtype vchPushValue;
+    PooledElement push_value;
+    valtype& vchPushValue = push_value.vch;
     ConditionStack vfExec;
-    std::vector<valtype> altstack;
+    PooledStack pooled_altstack;
+    std::vector<valtype>& altstack = pooled_altstack.stack;
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
     if (script.size() > MAX_SCRIPT_SIZE)
         return set_error(serror, SCRIPT_ERR_SCRIPT_SIZE);
@@ -437,7 +537,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                pushstack(stack, vchPushValue);
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -463,8 +563,9 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                 case OP_16:
                 {
                     // ( -- value)
-                    CScriptNum bn((int)opcode - (int)(OP_1 - 1));
-                    stack.push_back(bn.getvch());
+                    // Each of these values serializes to a single byte (see CScriptNum::serialize)
+                    const unsigned char vchValue = opcode == OP_1NEGATE ? 0x81 : (int)opcode - (int)(OP_1 - 1);
+                    pushstack(stack, &vchValue, &vchValue + 1);
                     // The result of these opcodes should always be the minimal way to push the data
                     // they push, so no need for a CheckMinimalPush here.
                 }
@@ -745,8 +846,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    stack.push_back(vch);
+                    pushstack(stack, stacktop(-1));
                 }
                 break;
 
@@ -850,7 +950,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     //    fEqual = !fEqual;
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fEqual ? vchTrue : vchFalse);
+                    pushstack(stack, fEqual ? vchTrue : vchFalse);
                     if (opcode == OP_EQUALVERIFY)
                     {
                         if (fEqual)
@@ -960,7 +1060,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     popstack(stack);
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fValue ? vchTrue : vchFalse);
+                    pushstack(stack, fValue ? vchTrue : vchFalse);
                 }
                 break;
 
@@ -978,19 +1078,20 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    // The hash replaces the input in place, reusing its buffer
+                    unsigned char vchHash[32];
+                    const size_t nHashSize = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
                     if (opcode == OP_RIPEMD160)
-                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA1)
-                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA256)
-                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH160)
-                        CHash160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CHash160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH256)
-                        CHash256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
-                    popstack(stack);
-                    stack.push_back(vchHash);
+                        CHash256().Write(vch.data(), vch.size()).Finalize(vchHash);
+                    vch.assign(vchHash, vchHash + nHashSize);
                 }
                 break;
 
@@ -1038,7 +1139,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
 
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    pushstack(stack, fSuccess ? vchTrue : vchFalse);
                     if (opcode == OP_CHECKSIGVERIFY)
                     {
                         if (fSuccess)
@@ -1148,7 +1249,7 @@ bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript&
                         return set_error(serror, SCRIPT_ERR_SIG_NULLDUMMY);
                     popstack(stack);
 
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    pushstack(stack, fSuccess ? vchTrue : vchFalse);
 
                     if (opcode == OP_CHECKMULTISIGVERIFY)
                     {
@@ -1318,6 +1419,73 @@ uint256 GetOutputsHash(const T& txTo)
     return ss.GetHash();
 }
 
+/** Size of a prevout, an empty script and a sequence */
+static constexpr size_t LEGACY_BLANK_INPUT_SIZE = 36 + 1 + 4;
+
+template <class T>
+void PrecomputeLegacy(const T& txTo, PrecomputedTransactionData& cache)
+{
+    CVectorWriter outputs(SER_GETHASH, 0, cache.legacy_outputs, 0);
+    for (const auto& txout : txTo.vout) {
+        outputs << txout;
+    }
+    for (int zero_sequences = 0; zero_sequences < 2; ++zero_sequences) {
+        std::vector<unsigned char>& inputs = cache.legacy_inputs[zero_sequences];
+        inputs.reserve(txTo.vin.size() * LEGACY_BLANK_INPUT_SIZE);
+        CVectorWriter writer(SER_GETHASH, 0, inputs, 0);
+        for (const auto& txin : txTo.vin) {
+            writer << txin.prevout << CScript() << (zero_sequences ? 0 : txin.nSequence);
+        }
+        assert(inputs.size() == txTo.vin.size() * LEGACY_BLANK_INPUT_SIZE);
+
+        std::vector<CHashWriter>& prefixes = cache.legacy_prefixes[zero_sequences];
+        prefixes.reserve(txTo.vin.size());
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << txTo.nVersion;
+        ::WriteCompactSize(ss, txTo.vin.size());
+        for (size_t i = 0; i < txTo.vin.size(); ++i) {
+            prefixes.push_back(ss);
+            ss.write((const char*)&inputs[i * LEGACY_BLANK_INPUT_SIZE], LEGACY_BLANK_INPUT_SIZE);
+        }
+    }
+    cache.legacy_ready = true;
+}
+
+/** The legacy signature hash of SignatureHash, from the serialized parts in cache. */
+template <class T>
+uint256 LegacySignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn, SigHashType sigHashType, const PrecomputedTransactionData& cache)
+{
+    const int zero_sequences = sigHashType.getBaseType() == BaseSigHashType::SINGLE || sigHashType.getBaseType() == BaseSigHashType::NONE;
+    const std::vector<unsigned char>& inputs = cache.legacy_inputs[zero_sequences];
+    const CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, sigHashType);
+
+    CHashWriter ss = sigHashType.hasAnyoneCanPay() ? CHashWriter(SER_GETHASH, 0) : cache.legacy_prefixes[zero_sequences][nIn];
+    if (sigHashType.hasAnyoneCanPay()) {
+        ss << txTo.nVersion;
+        ::WriteCompactSize(ss, 1);
+    }
+    txTmp.SerializeInput(ss, nIn);
+    if (!sigHashType.hasAnyoneCanPay() && nIn + 1 < txTo.vin.size()) {
+        ss.write((const char*)&inputs[(nIn + 1) * LEGACY_BLANK_INPUT_SIZE], (txTo.vin.size() - nIn - 1) * LEGACY_BLANK_INPUT_SIZE);
+    }
+    switch (sigHashType.getBaseType()) {
+    case BaseSigHashType::NONE:
+        ::WriteCompactSize(ss, 0);
+        break;
+    case BaseSigHashType::SINGLE:
+        ::WriteCompactSize(ss, nIn + 1);
+        for (unsigned int nOutput = 0; nOutput <= nIn; nOutput++) {
+            txTmp.SerializeOutput(ss, nOutput);
+        }
+        break;
+    default:
+        ::WriteCompactSize(ss, txTo.vout.size());
+        ss.write((const char*)cache.legacy_outputs.data(), cache.legacy_outputs.size());
+    }
+    ss << txTo.nLockTime << sigHashType;
+    return ss.GetHash();
+}
+
 } // namespace
 
 template <class T>
@@ -1330,6 +1498,10 @@ PrecomputedTransactionData::PrecomputedTransactionData(const T& txTo)
         hashOutputs = GetOutputsHash(txTo);
         ready = true;
     }
+    // Legacy signature hashes only grow quadratically with several inputs, some without witness
+    if (txTo.vin.size() > 1 && std::any_of(txTo.vin.begin(), txTo.vin.end(), [](const CTxIn& txin) { return txin.scriptWitness.IsNull(); })) {
+        PrecomputeLegacy(txTo, *this);
+    }
 }
 
 // explicit instantiation
@@ -1408,6 +1580,10 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo,
         }
     }
 
+    if (cache && cache->legacy_ready) {
+        return LegacySignatureHash(scriptCode, txTo, nIn, sigHashType, *cache);
+    }
+
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, sigHashType);
 
@@ -1539,7 +1715,11 @@ template class GenericTransactionSignatureChecker<CMutableTransaction>;
 
 static bool ExecuteWitnessScript(const Span<const valtype>& stack_span, const CScript& scriptPubKey, unsigned int flags, SigVersion sigversion, const BaseSignatureChecker& checker, ScriptError* serror)
 {
-    std::vector<valtype> stack{stack_span.begin(), stack_span.end()};
+    PooledStack pooled_stack;
+    std::vector<valtype>& stack = pooled_stack.stack;
+    for (const valtype& elem : stack_span) {
+        pushstack(stack, elem);
+    }
 
     // Disallow stack item size > MAX_SCRIPT_ELEMENT_SIZE in witness stack
     for (const valtype& elem : stack) {
@@ -1594,12 +1774,132 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     // There is intentionally no return statement here, to be able to use "control reaches end of non-void function" warnings to detect gaps in the logic above.
 }
 
+namespace {
+
+/**
+ * Read a data push from a script without copying it. Fails on anything the
+ * interpreter could treat differently from a plain push: other opcodes,
+ * oversized elements and non-minimal encodings (see CheckMinimalPush).
+ */
+bool GetMinimalPush(const CScript& script, CScript::const_iterator& pc, Span<const unsigned char>& data)
+{
+    const CScript::const_iterator start = pc;
+    opcodetype opcode;
+    if (!script.GetOp(pc, opcode) || opcode > OP_PUSHDATA4) return false;
+    const size_t header = opcode < OP_PUSHDATA1 ? 1 : opcode == OP_PUSHDATA1 ? 2 : opcode == OP_PUSHDATA2 ? 3 : 5;
+    data = Span<const unsigned char>(script.data() + (start - script.begin()) + header, pc - start - header);
+    if (data.size() > MAX_SCRIPT_ELEMENT_SIZE) return false;
+    if (data.size() == 1 && ((data[0] >= 1 && data[0] <= 16) || data[0] == 0x81)) return false;
+    if (data.size() <= 75) return opcode == data.size();
+    return opcode == (data.size() <= 255 ? OP_PUSHDATA1 : OP_PUSHDATA2);
+}
+
+bool HashesToKeyHash(Span<const unsigned char> pubkey, const unsigned char* keyhash)
+{
+    unsigned char hash[CHash160::OUTPUT_SIZE];
+    CHash160().Write(pubkey.data(), pubkey.size()).Finalize(hash);
+    return memcmp(hash, keyhash, sizeof(hash)) == 0;
+}
+
+/** The tail of OP_DUP OP_HASH160 <keyhash> OP_EQUALVERIFY OP_CHECKSIG, once the key hash matched. */
+bool CheckKeyHashSig(const valtype& vchSig, const valtype& vchPubKey, const CScript& scriptCode, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    if (!CheckSignatureEncoding(vchSig, flags, serror) ||
+        !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+        // serror is set
+        return false;
+    }
+    if (!checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion, flags)) {
+        if ((flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size()) {
+            return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+        }
+        return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    }
+    return true;
+}
+
+} // namespace
+
+bool VerifyKeyHashSpend(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool& result)
+{
+    // Leave flag combinations VerifyScript asserts on to VerifyScript.
+    if ((flags & SCRIPT_VERIFY_WITNESS) && !(flags & SCRIPT_VERIFY_P2SH)) return false;
+    if ((flags & SCRIPT_VERIFY_CLEANSTACK) && (~flags & (SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS))) return false;
+
+    if (scriptPubKey.IsPayToPubKeyHash()) {
+        // scriptSig must be exactly <sig> <pubkey>, which leaves a clean stack
+        // and passes SIGPUSHONLY and MINIMALDATA.
+        Span<const unsigned char> sig, pubkey;
+        CScript::const_iterator pc = scriptSig.begin();
+        if (!GetMinimalPush(scriptSig, pc, sig) || !GetMinimalPush(scriptSig, pc, pubkey) || pc != scriptSig.end()) {
+            return false;
+        }
+        set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+        result = false;
+        if (!HashesToKeyHash(pubkey, scriptPubKey.data() + 3)) {
+            return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+        }
+        const valtype vchSig(sig.begin(), sig.end()), vchPubKey(pubkey.begin(), pubkey.end());
+        if (!CheckKeyHashSig(vchSig, vchPubKey, scriptPubKey, flags, checker, SigVersion::BASE, serror)) {
+            return true;
+        }
+        if ((flags & SCRIPT_VERIFY_WITNESS) && !witness.IsNull()) {
+            return set_error(serror, SCRIPT_ERR_WITNESS_UNEXPECTED);
+        }
+        result = set_success(serror);
+        return true;
+    }
+
+    if (scriptPubKey.IsPayToWitnessPubKeyHash() && scriptSig.empty() && (flags & SCRIPT_VERIFY_WITNESS)) {
+        set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+        result = false;
+        // The bare program is evaluated as a push first, and must be true (see CastToBool).
+        const unsigned char* keyhash = scriptPubKey.data() + 2;
+        if (std::all_of(keyhash, keyhash + 19, [](unsigned char c) { return c == 0; }) && (keyhash[19] & 0x7f) == 0) {
+            return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        }
+        if (witness.stack.size() != 2) {
+            return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH);
+        }
+        const valtype& vchSig = witness.stack[0];
+        const valtype& vchPubKey = witness.stack[1];
+        if (vchSig.size() > MAX_SCRIPT_ELEMENT_SIZE || vchPubKey.size() > MAX_SCRIPT_ELEMENT_SIZE) {
+            return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+        }
+        if (!HashesToKeyHash(MakeSpan(vchPubKey), keyhash)) {
+            return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+        }
+        unsigned char script_code[25] = {OP_DUP, OP_HASH160, 0x14};
+        std::copy(keyhash, keyhash + 20, script_code + 3);
+        script_code[23] = OP_EQUALVERIFY;
+        script_code[24] = OP_CHECKSIG;
+        if (!CheckKeyHashSig(vchSig, vchPubKey, CScript(script_code, script_code + sizeof(script_code)), flags, checker, SigVersion::WITNESS_V0, serror)) {
+            return true;
+        }
+        result = set_success(serror);
+        return true;
+    }
+
+    return false;
+}
+
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    // Plain key hash spends don't need the interpreter.
+    bool result;
+    if (VerifyKeyHashSpend(scriptSig, scriptPubKey, witness ? *witness : CScriptWitness(), flags, checker, serror, result)) {
+        return result;
+    }
+    return VerifyScriptInterpreted(scriptSig, scriptPubKey, witness, flags, checker, serror);
+}
+
+bool VerifyScriptInterpreted(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
 {
     static const CScriptWitness emptyWitness;
     if (witness == nullptr) {
         witness = &emptyWitness;
     }
+
     bool hadWitness = false;
 
     set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
@@ -1610,12 +1910,18 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
 
     // scriptSig and scriptPubKey must be evaluated sequentially on the same stack
     // rather than being simply concatenated (see CVE-2010-5141)
-    std::vector<std::vector<unsigned char> > stack, stackCopy;
+    PooledStack pooled_stack, pooled_stack_copy;
+    std::vector<valtype>& stack = pooled_stack.stack;
+    std::vector<valtype>& stackCopy = pooled_stack_copy.stack;
     if (!EvalScript(stack, scriptSig, flags, checker, SigVersion::BASE, serror))
         // serror is set
         return false;
-    if (flags & SCRIPT_VERIFY_P2SH)
-        stackCopy = stack;
+    // The copy is only needed to evaluate the redeem script of a P2SH output
+    if ((flags & SCRIPT_VERIFY_P2SH) && scriptPubKey.IsPayToScriptHash()) {
+        for (const valtype& vch : stack) {
+            pushstack(stackCopy, vch);
+        }
+    }
     if (!EvalScript(stack, scriptPubKey, flags, checker, SigVersion::BASE, serror))
         // serror is set
         return false;
@@ -11,6 +11,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <hash.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
 #include <script/sighashtype.h>
@@ -128,6 +129,20 @@ struct PrecomputedTransactionData
     uint256 hashPrevouts, hashSequence, hashOutputs;
     bool ready = false;
 
+    /**
+     * Shared parts of the legacy (SigVersion::BASE) signature hashes of a transaction with several
+     * inputs, which otherwise reserialize and rehash the whole transaction for every input.
+     * Index 0 is for SIGHASH_ALL, index 1 for SIGHASH_NONE and SIGHASH_SINGLE, which zero the
+     * sequences of the other inputs.
+     */
+    bool legacy_ready = false;
+    //! Every input as serialized for the signature hash of another input: script blanked, each LEGACY_BLANK_INPUT_SIZE bytes
+    std::vector<unsigned char> legacy_inputs[2];
+    //! All outputs, serialized
+    std::vector<unsigned char> legacy_outputs;
+    //! Hash states after nVersion, the input count and the first i blanked inputs
+    std::vector<CHashWriter> legacy_prefixes[2];
+
     template <class T>
     explicit PrecomputedTransactionData(const T& tx);
 };
@@ -197,6 +212,20 @@ using MutableTransactionSignatureChecker = GenericTransactionSignatureChecker<CM
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = nullptr);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
 
+/**
+ * VerifyScript without the VerifyKeyHashSpend shortcut: every spend runs through the script
+ * interpreter. VerifyScript must always agree with it, which the eval_script fuzz target checks.
+ */
+bool VerifyScriptInterpreted(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = nullptr);
+
+/**
+ * Verify a spend of a P2PKH or P2WPKH output with direct signature checks
+ * instead of the script interpreter. Returns false if the scripts do not have
+ * the shape this handles, in which case they must go through the interpreter.
+ * Otherwise sets result and serror exactly as VerifyScript would.
+ */
+bool VerifyKeyHashSpend(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool& result);
+
 size_t CountWitnessSigOps(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags);
 
 int FindAndDelete(CScript& script, const CScript& b);
@@ -538,7 +538,9 @@ public:
      */
     unsigned int GetSigOpCount(const CScript& scriptSig) const;
 
+    bool IsPayToPubKeyHash() const;
     bool IsPayToScriptHash() const;
+    bool IsPayToWitnessPubKeyHash() const;
     bool IsPayToWitnessScriptHash() const;
     bool IsWitnessProgram(int& version, std::vector<unsigned char>& program) const;
 
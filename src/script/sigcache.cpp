@@ -11,6 +11,10 @@
 #include <util/system.h>
 
 #include <cuckoocache.h>
+
+#include <array>
+#include <atomic>
+
 #include <boost/thread.hpp>
 
 namespace {
@@ -18,6 +22,10 @@ namespace {
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The cache is split into SIGNATURE_CACHE_SHARDS independent shards, each with
+ * its own lock, so that mempool acceptance and block validation inserting
+ * signatures at the same time rarely wait on each other.
  */
 class CSignatureCache
 {
@@ -25,8 +33,26 @@ private:
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    struct Shard {
+        map_type setValid;
+        boost::shared_mutex cs_sigcache;
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<uint64_t> inserts{0};
+        std::atomic<uint64_t> evictions{0};
+        uint32_t capacity{0};
+    };
+    std::array<Shard, SIGNATURE_CACHE_SHARDS> shards;
+
+    /**
+     * The shard is picked from the low byte of the last hash word. The cuckoo
+     * cache maps each word onto a bucket by its high bits, so this leaves the
+     * placement within a shard uniform.
+     */
+    Shard& GetShard(const uint256& entry)
+    {
+        return shards[*(entry.begin() + 28) % SIGNATURE_CACHE_SHARDS];
+    }
 
 public:
     CSignatureCache()
@@ -43,18 +69,50 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        Shard& shard = GetShard(entry);
+        bool found;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+            found = shard.setValid.contains(entry, erase);
+        }
+        (found ? shard.hits : shard.misses).fetch_add(1, std::memory_order_relaxed);
+        return found;
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        Shard& shard = GetShard(entry);
+        bool kept;
+        {
+            boost::unique_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+            kept = shard.setValid.insert(entry);
+        }
+        shard.inserts.fetch_add(1, std::memory_order_relaxed);
+        if (!kept) shard.evictions.fetch_add(1, std::memory_order_relaxed);
     }
+
     uint32_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        uint32_t elements = 0;
+        for (Shard& shard : shards) {
+            boost::unique_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+            shard.capacity = shard.setValid.setup_bytes(n / SIGNATURE_CACHE_SHARDS);
+            elements += shard.capacity;
+        }
+        return elements;
+    }
+
+    SignatureCacheStats GetStats()
+    {
+        SignatureCacheStats stats;
+        for (const Shard& shard : shards) {
+            stats.hits += shard.hits.load(std::memory_order_relaxed);
+            stats.misses += shard.misses.load(std::memory_order_relaxed);
+            stats.inserts += shard.inserts.load(std::memory_order_relaxed);
+            stats.evictions += shard.evictions.load(std::memory_order_relaxed);
+            stats.capacity += shard.capacity;
+        }
+        return stats;
     }
 };
 
@@ -79,6 +137,11 @@ void InitSignatureCache()
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -16,6 +16,8 @@
 static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 // Maximum sig cache size allowed
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
+// Number of independently locked parts the signature cache is split into
+static const unsigned int SIGNATURE_CACHE_SHARDS = 16;
 
 class CPubKey;
 
@@ -53,4 +55,17 @@ public:
 
 void InitSignatureCache();
 
+/** Counters of the signature cache since startup. */
+struct SignatureCacheStats {
+    uint64_t hits{0};
+    uint64_t misses{0};
+    uint64_t inserts{0};
+    //! Inserts that pushed an entry (possibly the new one) out of a full cache
+    uint64_t evictions{0};
+    //! Number of entries the cache can hold
+    uint64_t capacity{0};
+};
+
+SignatureCacheStats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
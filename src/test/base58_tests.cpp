@@ -5,6 +5,7 @@
 #include <test/data/base58_encode_decode.json.h>
 
 #include <base58.h>
+#include <test/util/json.h>
 #include <test/util/setup_common.h>
 #include <util/strencodings.h>
 #include <util/vector.h>
@@ -13,9 +14,6 @@
 
 #include <boost/test/unit_test.hpp>
 
-
-extern UniValue read_json(const std::string& jsondata);
-
 BOOST_FIXTURE_TEST_SUITE(base58_tests, BasicTestingSetup)
 
 // Goal: test low-level base58 encoding functionality
@@ -44,7 +44,9 @@ static CBlock BuildBlockTestCase() {
     bool mutated;
     block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
     assert(!mutated);
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+    // The blocks do not connect to the chain, so they are checked as if at height 0, with the
+    // original algorithm
+    while (!CheckProofOfWork(block.GetPoWHash(false, false), block.nBits, false, Params().GetConsensus())) ++block.nNonce;
     return block;
 }
 
@@ -292,7 +294,7 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     bool mutated;
     block.hashMerkleRoot = BlockMerkleRoot(block, &mutated);
     assert(!mutated);
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, Params().GetConsensus())) ++block.nNonce;
+    while (!CheckProofOfWork(block.GetPoWHash(false, false), block.nBits, false, Params().GetConsensus())) ++block.nNonce;
 
     // Test simple header round-trip with only coinbase
     {
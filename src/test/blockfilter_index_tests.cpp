@@ -76,7 +76,10 @@ CBlock BuildChainTestingSetup::CreateBlock(const CBlockIndex* prev,
     unsigned int extraNonce = 0;
     IncrementExtraNonce(&block, prev, extraNonce);
 
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+    const int nHeight = prev->nHeight + 1;
+    const bool isPostFork = nHeight >= chainparams.SwitchLyra2REv2_LWMA();
+    const bool isPostForkLyra2C0ban = nHeight >= chainparams.SwitchLyra2REvc0ban_LWMA();
+    while (!CheckProofOfWork(block.GetPoWHash(isPostFork, isPostForkLyra2C0ban), block.nBits, isPostFork, chainparams.GetConsensus())) ++block.nNonce;
 
     return block;
 }
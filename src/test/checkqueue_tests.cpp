@@ -10,6 +10,7 @@
 #include <checkqueue.h>
 #include <boost/test/unit_test.hpp>
 #include <boost/thread.hpp>
+#include <algorithm>
 #include <atomic>
 #include <thread>
 #include <vector>
@@ -123,7 +124,24 @@ struct FrozenCleanupCheck {
     void swap(FrozenCleanupCheck& x){std::swap(should_freeze, x.should_freeze);};
 };
 
+struct OrderedCheck {
+    static std::mutex m;
+    static std::vector<int> order;
+    int tag{0};
+    OrderedCheck(int tag_in) : tag(tag_in){};
+    OrderedCheck(){};
+    bool operator()()
+    {
+        std::lock_guard<std::mutex> l(m);
+        order.push_back(tag);
+        return true;
+    }
+    void swap(OrderedCheck& x) { std::swap(x.tag, tag); };
+};
+
 // Static Allocations
+std::mutex OrderedCheck::m;
+std::vector<int> OrderedCheck::order;
 std::mutex FrozenCleanupCheck::m{};
 std::atomic<uint64_t> FrozenCleanupCheck::nFrozen{0};
 std::condition_variable FrozenCleanupCheck::cv{};
@@ -139,16 +157,17 @@ typedef CCheckQueue<FailingCheck> Failing_Queue;
 typedef CCheckQueue<UniqueCheck> Unique_Queue;
 typedef CCheckQueue<MemoryCheck> Memory_Queue;
 typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
+typedef CCheckQueue<OrderedCheck> Ordered_Queue;
 
 
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
-static void Correct_Queue_range(std::vector<size_t> range)
+static void Correct_Queue_range(std::vector<size_t> range, int threads = SCRIPT_CHECK_THREADS)
 {
     auto small_queue = MakeUnique<Correct_Queue>(QUEUE_BATCH_SIZE);
     boost::thread_group tg;
-    for (auto x = 0; x < SCRIPT_CHECK_THREADS; ++x) {
+    for (auto x = 0; x < threads; ++x) {
        tg.create_thread([&]{small_queue->Thread();});
     }
     // Make vChecks here to save on malloc (this test can be slow...)
@@ -205,6 +224,16 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
         range.push_back(i);
     Correct_Queue_range(range);
 }
+/** Test that checks are correct with more workers than worker queues, so
+ * that workers share queues
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Many_Workers)
+{
+    std::vector<size_t> range;
+    for (size_t i = 0; i < 20000; i += 1 + InsecureRandRange(1000))
+        range.push_back(i);
+    Correct_Queue_range(range, 100);
+}
 
 
 /** Test that failing checks are caught */
@@ -379,6 +408,78 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
 }
 
 
+/** Test that queues sharing the threads of a pool are each run correctly, concurrently */
+BOOST_AUTO_TEST_CASE(test_CheckQueuePool_Correct)
+{
+    CCheckQueuePool pool;
+    auto unique_queue = MakeUnique<Unique_Queue>(QUEUE_BATCH_SIZE, &pool, 1);
+    auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE, &pool, 0);
+    boost::thread_group tg;
+    for (auto x = 0; x < SCRIPT_CHECK_THREADS; ++x) {
+       tg.create_thread([&]{pool.Thread();});
+    }
+
+    // Boost.Test assertions are not thread safe, so the second master only counts failures
+    std::atomic<int> unique_fails{0};
+    std::thread unique_master([&] {
+        for (size_t times = 0; times < 100; ++times) {
+            UniqueCheck::results.clear();
+            CCheckQueueControl<UniqueCheck> control(unique_queue.get());
+            for (size_t i = 0; i < 1000; i += 10) {
+                std::vector<UniqueCheck> vChecks;
+                for (size_t k = i; k < i + 10; k++) vChecks.emplace_back(k);
+                control.Add(vChecks);
+            }
+            if (!control.Wait()) ++unique_fails;
+            for (size_t i = 0; i < 1000; i++) {
+                if (UniqueCheck::results.count(i) != 1) ++unique_fails;
+            }
+        }
+    });
+    for (size_t times = 0; times < 100; ++times) {
+        CCheckQueueControl<FailingCheck> control(fail_queue.get());
+        std::vector<FailingCheck> vChecks(1000, false);
+        vChecks[InsecureRandRange(1000)] = times % 2;
+        control.Add(vChecks);
+        BOOST_REQUIRE_EQUAL(control.Wait(), times % 2 == 0);
+    }
+    unique_master.join();
+    BOOST_REQUIRE_EQUAL(unique_fails, 0);
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+/** Test that the threads of a pool run the checks of higher priority queues first */
+BOOST_AUTO_TEST_CASE(test_CheckQueuePool_Priority)
+{
+    CCheckQueuePool pool;
+    auto low_queue = MakeUnique<Ordered_Queue>(QUEUE_BATCH_SIZE, &pool, 1);
+    auto high_queue = MakeUnique<Ordered_Queue>(QUEUE_BATCH_SIZE, &pool, 0);
+    OrderedCheck::order.clear();
+    CCheckQueueControl<OrderedCheck> low_control(low_queue.get());
+    CCheckQueueControl<OrderedCheck> high_control(high_queue.get());
+    std::vector<OrderedCheck> vChecks(1000, OrderedCheck(1));
+    low_control.Add(vChecks);
+    vChecks.assign(1000, OrderedCheck(0));
+    high_control.Add(vChecks);
+
+    // With a single thread, and the masters not helping, all checks run in order of priority
+    boost::thread_group tg;
+    tg.create_thread([&]{pool.Thread();});
+    while (true) {
+        {
+            std::lock_guard<std::mutex> l(OrderedCheck::m);
+            if (OrderedCheck::order.size() == 2000) break;
+        }
+        UninterruptibleSleep(std::chrono::milliseconds{1});
+    }
+    BOOST_REQUIRE(high_control.Wait());
+    BOOST_REQUIRE(low_control.Wait());
+    BOOST_CHECK(std::is_sorted(OrderedCheck::order.begin(), OrderedCheck::order.end()));
+    tg.interrupt_all();
+    tg.join_all();
+}
+
 /** Test that CCheckQueueControl is threadsafe */
 BOOST_AUTO_TEST_CASE(test_CheckQueueControl_Locks)
 {
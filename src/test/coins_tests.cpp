@@ -5,14 +5,20 @@
 #include <attributes.h>
 #include <clientversion.h>
 #include <coins.h>
+#include <crypto/muhash.h>
+#include <node/coinstats.h>
 #include <script/standard.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <validation.h>
 
+#include <atomic>
 #include <map>
+#include <set>
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -861,4 +867,218 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+static void CheckAddFetchedCoin(CAmount cache_value, CAmount expected_value, char cache_flags, char expected_flags)
+{
+    SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+    Coin coin;
+    SetCoinsValue(VALUE3, coin);
+    test.cache.AddFetchedCoin(OUTPOINT, std::move(coin));
+    test.cache.SelfTest();
+
+    CAmount result_value;
+    char result_flags;
+    GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+    BOOST_CHECK_EQUAL(result_value, expected_value);
+    BOOST_CHECK_EQUAL(result_flags, expected_flags);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_add_fetched)
+{
+    /* Check AddFetchedCoin behavior, handing a coin read from the backing view
+     * to a cache, and checking the resulting entry in the cache. The coin must
+     * look as if the cache had fetched it itself, and never replace an entry.
+     *
+     *                  Cache   Result  Cache        Result
+     *                  Value   Value   Flags        Flags
+     */
+    CheckAddFetchedCoin(ABSENT, VALUE3, NO_ENTRY   , 0          );
+    CheckAddFetchedCoin(PRUNED, PRUNED, 0          , 0          );
+    CheckAddFetchedCoin(PRUNED, PRUNED, FRESH      , FRESH      );
+    CheckAddFetchedCoin(PRUNED, PRUNED, DIRTY      , DIRTY      );
+    CheckAddFetchedCoin(PRUNED, PRUNED, DIRTY|FRESH, DIRTY|FRESH);
+    CheckAddFetchedCoin(VALUE2, VALUE2, 0          , 0          );
+    CheckAddFetchedCoin(VALUE2, VALUE2, FRESH      , FRESH      );
+    CheckAddFetchedCoin(VALUE2, VALUE2, DIRTY      , DIRTY      );
+    CheckAddFetchedCoin(VALUE2, VALUE2, DIRTY|FRESH, DIRTY|FRESH);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_release_cache_keep)
+{
+    CCoinsView base;
+    CCoinsViewCacheTest cache(&base);
+    std::vector<COutPoint> outpoints;
+    for (uint32_t height = 1; height <= 1000; ++height) {
+        const COutPoint outpoint(InsecureRand256(), 0);
+        Coin coin;
+        coin.out.nValue = height;
+        coin.out.scriptPubKey.assign((uint32_t)25, 1);
+        coin.nHeight = height;
+        cache.AddCoin(outpoint, std::move(coin), false);
+        outpoints.push_back(outpoint);
+    }
+    // A spent young coin is not kept
+    BOOST_CHECK(cache.SpendCoin(outpoints.back()));
+    const size_t usage = cache.DynamicMemoryUsage();
+
+    CCoinsMap coins;
+    cache.ReleaseCache(coins, usage / 4);
+    BOOST_CHECK_EQUAL(coins.size(), 999U);
+    cache.SelfTest();
+
+    // About a quarter of the coins are kept, the youngest ones, unmodified
+    BOOST_CHECK(cache.GetCacheSize() > 200 && cache.GetCacheSize() <= 250);
+    BOOST_CHECK(cache.DynamicMemoryUsage() < usage / 4 + usage / 20);
+    const uint32_t min_height = 1000 - cache.GetCacheSize();
+    for (uint32_t height = 1; height < 1000; ++height) {
+        BOOST_CHECK_EQUAL(cache.HaveCoinInCache(outpoints[height - 1]), height >= min_height);
+    }
+    for (const auto& entry : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.second.flags, 0);
+        BOOST_CHECK(entry.second.coin == coins.find(entry.first)->second.coin);
+    }
+
+    // Without keep_bytes the cache is left empty
+    coins.clear();
+    cache.ReleaseCache(coins);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(cache.usage(), 0U);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_db_background_write)
+{
+    CCoinsViewDB db(GetDataDir() / "chainstate", 1 << 20, true, false);
+    std::map<COutPoint, Coin> expected;
+    auto add_coin = [&](CCoinsViewCache& cache) {
+        const COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+        Coin coin;
+        coin.out.nValue = InsecureRand32();
+        coin.out.scriptPubKey.assign((uint32_t)25, 1);
+        coin.nHeight = 1;
+        expected[outpoint] = coin;
+        cache.AddCoin(outpoint, std::move(coin), false);
+    };
+
+    // Write a cache full of coins in the background
+    const uint256 block1 = InsecureRand256();
+    std::atomic<int> written{0};
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 20000; ++i) add_coin(cache);
+        cache.SetBestBlock(block1);
+        CCoinsMap coins;
+        cache.ReleaseCache(coins);
+        BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+        BOOST_CHECK(db.BatchWriteInBackground(coins, block1, [&](bool ok) { written = ok ? 1 : -1; }));
+    }
+
+    // Meanwhile a new cache on top sees the coins, whether written yet or not
+    CCoinsViewCache cache(&db);
+    BOOST_CHECK(cache.GetBestBlock() == block1);
+    std::vector<COutPoint> spent;
+    for (const auto& entry : expected) {
+        BOOST_CHECK(cache.AccessCoin(entry.first) == entry.second);
+        if (spent.size() < 1000) spent.push_back(entry.first);
+    }
+    for (const COutPoint& outpoint : spent) {
+        BOOST_CHECK(cache.SpendCoin(outpoint));
+        expected.erase(outpoint);
+    }
+    for (int i = 0; i < 1000; ++i) add_coin(cache);
+
+    // Flushing normally waits for the background write, and writes on top of it
+    const uint256 block2 = InsecureRand256();
+    cache.SetBestBlock(block2);
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK_EQUAL(written, 1);
+    BOOST_CHECK(db.WaitForBackgroundWrite());
+
+    BOOST_CHECK(db.GetBestBlock() == block2);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    for (const COutPoint& outpoint : spent) {
+        BOOST_CHECK(!db.HaveCoin(outpoint));
+    }
+    size_t count = 0;
+    std::unique_ptr<CCoinsViewCursor> cursor(db.Cursor());
+    for (; cursor->Valid(); cursor->Next()) {
+        COutPoint outpoint;
+        Coin coin;
+        BOOST_REQUIRE(cursor->GetKey(outpoint) && cursor->GetValue(coin));
+        auto it = expected.find(outpoint);
+        BOOST_REQUIRE(it != expected.end());
+        BOOST_CHECK(coin == it->second);
+        ++count;
+    }
+    BOOST_CHECK_EQUAL(count, expected.size());
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_stats_sharded, TestingSetup)
+{
+    CCoinsViewDB db(GetDataDir() / "coinstats", 1 << 20, true, false);
+    std::map<COutPoint, Coin> expected;
+    {
+        CCoinsViewCache cache(&db);
+        for (int i = 0; i < 5000; ++i) {
+            const COutPoint outpoint(InsecureRand256(), InsecureRandRange(4));
+            Coin coin;
+            coin.out.nValue = InsecureRand32();
+            coin.out.scriptPubKey.assign((uint32_t)InsecureRandRange(40), 1);
+            coin.nHeight = InsecureRandRange(1000);
+            coin.fCoinBase = InsecureRandBool();
+            expected[outpoint] = coin;
+            cache.AddCoin(outpoint, std::move(coin), true);
+        }
+        cache.SetBestBlock(WITH_LOCK(cs_main, return ::ChainActive().Tip()->GetBlockHash()));
+        BOOST_CHECK(cache.Flush());
+    }
+
+    MuHash3072 expected_muhash;
+    std::set<uint256> txids;
+    CAmount amount = 0;
+    for (const auto& entry : expected) {
+        InsertCoinHash(expected_muhash, entry.first, entry.second);
+        txids.insert(entry.first.hash);
+        amount += entry.second.out.nValue;
+    }
+
+    // The shards, on the script check threads, add up to the same statistics as one cursor
+    CCoinsStats serialized, muhash, none;
+    BOOST_CHECK(GetUTXOStats(&db, serialized, CoinStatsHashType::HASH_SERIALIZED));
+    BOOST_CHECK(GetUTXOStats(&db, muhash, CoinStatsHashType::MUHASH));
+    BOOST_CHECK(GetUTXOStats(&db, none, CoinStatsHashType::NONE));
+    for (const CCoinsStats* stats : {&serialized, &muhash, &none}) {
+        BOOST_CHECK(stats->hashBlock == db.GetBestBlock());
+        BOOST_CHECK_EQUAL(stats->coins_count, expected.size());
+        BOOST_CHECK_EQUAL(stats->nTransactionOutputs, expected.size());
+        BOOST_CHECK_EQUAL(stats->nTransactions, txids.size());
+        BOOST_CHECK_EQUAL(stats->nTotalAmount, amount);
+        BOOST_CHECK_EQUAL(stats->nBogoSize, serialized.nBogoSize);
+    }
+    uint256 expected_hash;
+    expected_muhash.Finalize(expected_hash);
+    BOOST_CHECK(muhash.hashSerialized == expected_hash);
+    BOOST_CHECK(!serialized.hashSerialized.IsNull());
+    BOOST_CHECK(none.hashSerialized.IsNull());
+
+    // The cursors cover each coin once, and do not see what is written after they are made
+    const std::vector<std::unique_ptr<CCoinsViewCursor>> cursors = db.Cursors(3);
+    BOOST_REQUIRE_EQUAL(cursors.size(), 3U);
+    {
+        CCoinsViewCache cache(&db);
+        BOOST_CHECK(cache.SpendCoin(expected.begin()->first));
+        cache.SetBestBlock(db.GetBestBlock());
+        BOOST_CHECK(cache.Flush());
+    }
+    size_t count = 0;
+    for (const auto& cursor : cursors) {
+        for (; cursor->Valid(); cursor->Next()) {
+            COutPoint outpoint;
+            Coin coin;
+            BOOST_REQUIRE(cursor->GetKey(outpoint) && cursor->GetValue(coin));
+            BOOST_CHECK(coin == expected[outpoint]);
+            ++count;
+        }
+    }
+    BOOST_CHECK_EQUAL(count, expected.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,117 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <index/coinstatsindex.h>
+#include <node/coinstats.h>
+#include <policy/policy.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(coinstatsindex_tests)
+
+static void CheckIndexMatchesChainstate(const CoinStatsIndex& coin_stats_index)
+{
+    ::ChainstateActive().ForceFlushStateToDisk();
+    CCoinsStats expected;
+    CCoinsViewDB* coins_view = WITH_LOCK(cs_main, return &ChainstateActive().CoinsDB());
+    BOOST_REQUIRE(GetUTXOStats(coins_view, expected, CoinStatsHashType::MUHASH));
+
+    CCoinsStats stats;
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    BOOST_REQUIRE(coin_stats_index.LookupStats(tip, stats));
+    BOOST_CHECK(stats.index_used);
+    BOOST_CHECK_EQUAL(stats.hashBlock, expected.hashBlock);
+    BOOST_CHECK_EQUAL(stats.nHeight, expected.nHeight);
+    BOOST_CHECK_EQUAL(stats.hashSerialized, expected.hashSerialized);
+    BOOST_CHECK_EQUAL(stats.nTransactionOutputs, expected.nTransactionOutputs);
+    BOOST_CHECK_EQUAL(stats.nBogoSize, expected.nBogoSize);
+    BOOST_CHECK_EQUAL(stats.nTotalAmount, expected.nTotalAmount);
+}
+
+BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
+{
+    CoinStatsIndex coin_stats_index(1 << 20, true);
+
+    CCoinsStats stats;
+    const CBlockIndex* tip = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+
+    // The statistics should not be found in the index before it is started.
+    BOOST_CHECK(!coin_stats_index.LookupStats(tip, stats));
+
+    // BlockUntilSyncedToCurrentChain should return false before the index is started.
+    BOOST_CHECK(!coin_stats_index.BlockUntilSyncedToCurrentChain());
+
+    coin_stats_index.Start();
+
+    // Allow the index to catch up with the block index.
+    constexpr int64_t timeout_ms = 10 * 1000;
+    int64_t time_start = GetTimeMillis();
+    while (!coin_stats_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(time_start + timeout_ms > GetTimeMillis());
+        UninterruptibleSleep(std::chrono::milliseconds{100});
+    }
+
+    // The index should agree with a scan of the chainstate.
+    CheckIndexMatchesChainstate(coin_stats_index);
+
+    // Spend a coinbase in a new block, so that the coins it spends are taken out of the index.
+    CScript script_pub_key = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    spend.vout.resize(2);
+    spend.vout[0].nValue = m_coinbase_txns[0]->vout[0].nValue;
+    spend.vout[0].scriptPubKey = script_pub_key;
+    spend.vout[1].nValue = 0;
+    spend.vout[1].scriptPubKey = CScript() << OP_RETURN;
+    FillableSigningProvider keystore;
+    BOOST_CHECK(keystore.AddKey(coinbaseKey));
+    SignatureData sigdata;
+    BOOST_CHECK(ProduceSignature(keystore, MutableTransactionSignatureCreator(&spend, 0, m_coinbase_txns[0]->vout[0].nValue, SigHashType().withForkId(), STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_REPLAY_PROTECTION), script_pub_key, sigdata));
+    UpdateInput(spend.vin[0], sigdata);
+
+    const CBlockIndex* spend_parent = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+    CreateAndProcessBlock({spend}, script_pub_key);
+    BOOST_CHECK(coin_stats_index.BlockUntilSyncedToCurrentChain());
+    CheckIndexMatchesChainstate(coin_stats_index);
+
+    // The statistics of earlier blocks are kept.
+    BOOST_REQUIRE(coin_stats_index.LookupStats(tip, stats));
+    BOOST_CHECK_EQUAL(stats.nHeight, tip->nHeight);
+
+    // Replace the block with the spend by two blocks that do not have it. The index follows the
+    // reorg once the new blocks are connected.
+    {
+        BlockValidationState state;
+        CBlockIndex* spend_block = WITH_LOCK(cs_main, return ::ChainActive().Tip());
+        BOOST_CHECK(InvalidateBlock(state, Params(), spend_block));
+    }
+    BOOST_CHECK_EQUAL(WITH_LOCK(cs_main, return ::ChainActive().Tip()), spend_parent);
+    CScript other_script_pub_key = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
+    CreateAndProcessBlock({}, other_script_pub_key);
+    CreateAndProcessBlock({}, other_script_pub_key);
+    BOOST_CHECK(coin_stats_index.BlockUntilSyncedToCurrentChain());
+    CheckIndexMatchesChainstate(coin_stats_index);
+
+    // shutdown sequence (c.f. Shutdown() in init.cpp)
+    coin_stats_index.Stop();
+
+    // The index job may be scheduled, so stop scheduler before destructing
+    m_node.scheduler->stop();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    // Rest of shutdown sequence and destructors happen in ~TestingSetup()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,18 +2,25 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/Lyra2RE/Lyra2.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
+#include <crypto/Lyra2RE/sph_bmw.h>
 #include <crypto/aes.h>
 #include <crypto/chacha20.h>
 #include <crypto/chacha_poly_aead.h>
+#include <crypto/common.h>
 #include <crypto/poly1305.h>
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <crypto/muhash.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
 #include <crypto/sha512.h>
+#include <primitives/block.h>
 #include <random.h>
+#include <streams.h>
 #include <util/strencodings.h>
 #include <test/util/setup_common.h>
 
@@ -67,6 +74,30 @@ static void TestHMACSHA512(const std::string &hexkey, const std::string &hexin,
     TestVector(CHMAC_SHA512(key.data(), key.size()), ParseHex(hexin), ParseHex(hexout));
 }
 
+static void TestLyra2(void (*hash)(const char*, char*), const std::string &hexin, const std::string &hexout)
+{
+    std::vector<unsigned char> in = ParseHex(hexin);
+    std::vector<unsigned char> correctout = ParseHex(hexout);
+    std::vector<unsigned char> out(32);
+    assert(in.size() == 80);
+    hash((const char*)in.data(), (char*)out.data());
+    BOOST_CHECK(out == correctout);
+    // Hashing must not depend on state left behind by a previous call.
+    hash((const char*)in.data(), (char*)out.data());
+    BOOST_CHECK(out == correctout);
+}
+
+static void TestBMW256(const std::string &hexin, const std::string &hexout)
+{
+    std::vector<unsigned char> in = ParseHex(hexin);
+    std::vector<unsigned char> out(32);
+    sph_bmw256_context ctx;
+    sph_bmw256_init(&ctx);
+    sph_bmw256(&ctx, in.data(), in.size());
+    sph_bmw256_close(&ctx, out.data());
+    BOOST_CHECK_EQUAL(HexStr(out), hexout);
+}
+
 static void TestAES256(const std::string &hexkey, const std::string &hexin, const std::string &hexout)
 {
     std::vector<unsigned char> key = ParseHex(hexkey);
@@ -413,6 +444,141 @@ BOOST_AUTO_TEST_CASE(hmac_sha512_testvectors) {
                    "fb29795e79f2ef27f68cb1e16d76178c307a67beaad9456fac5fdffeadb16e2c");
 }
 
+BOOST_AUTO_TEST_CASE(lyra2_testvectors) {
+    // No c0ban chain headers are at hand, so these are the hashes of the Lyra2RE code as it was
+    // before the fixed-size Lyra2 and the SIMD sponges, built at -O0 and at -O2 with
+    // -fno-strict-aliasing (which agree). Optimized builds of that code without
+    // -fno-strict-aliasing got Lyra2REv2 and Lyra2REc0ban wrong, see bmw256_testvectors.
+    TestLyra2(lyra2re_hash,
+              "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+              "c6165cb3a82b8f39ed9feaa5fa5be3d7041b0fd30128a42ed0b78ff2b665f81a");
+    TestLyra2(lyra2re_hash,
+              "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f",
+              "dda1487831430df5d5fc1ee3a7bac672a13589dfdcf6a44efdc143a5c0202d10");
+    TestLyra2(lyra2re_hash,
+              "030a11181f262d343b424950575e656c737a81888f969da4abb2b9c0c7ced5dce3eaf1f8ff060d141b222930373e454c535a61686f767d848b9299a0a7aeb5bcc3cad1d8dfe6edf4fb020910171e252c",
+              "3968583b52d5ec0f7eb786bd0822f0c3543a6665ffb4835f14507502ec451e04");
+    TestLyra2(lyra2re2_hash,
+              "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+              "a297c8d991274c8727f515d4b129e18ddb1c61b31c552c963efce71095baa90c");
+    TestLyra2(lyra2re2_hash,
+              "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f",
+              "2246faafca15a01a35c81a3f801fe8338942565bdb75a505517372aa0c7afdd0");
+    TestLyra2(lyra2re2_hash,
+              "030a11181f262d343b424950575e656c737a81888f969da4abb2b9c0c7ced5dce3eaf1f8ff060d141b222930373e454c535a61686f767d848b9299a0a7aeb5bcc3cad1d8dfe6edf4fb020910171e252c",
+              "66f221a6b9a5eb0676d3bd692fb0d052198af556acb1f248d145cbf9f0f1296c");
+    TestLyra2(lyra2rec0ban_hash,
+              "0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000",
+              "05bd60af2fc4a48e114a6762a89af1365f80d64c43da3f83d6cfc9ca1b564c46");
+    TestLyra2(lyra2rec0ban_hash,
+              "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f",
+              "eb50574077e62ec9a89524bc362c3d9a2e1c3cc17a1c66f655c2da8e5ab267a3");
+    TestLyra2(lyra2rec0ban_hash,
+              "030a11181f262d343b424950575e656c737a81888f969da4abb2b9c0c7ced5dce3eaf1f8ff060d141b222930373e454c535a61686f767d848b9299a0a7aeb5bcc3cad1d8dfe6edf4fb020910171e252c",
+              "a073c9990004bb652070a356d94d7c5a277f07bcbd7d279f333f89951a974962");
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_fixed_size) {
+    // The allocation-free variants used for PoW hashing must agree with the generic LYRA2 and
+    // LYRA2_old, which allocate their matrix for the requested dimensions.
+    for (int i = 0; i < 8; ++i) {
+        std::vector<unsigned char> pwd = g_insecure_rand_ctx.randbytes(32);
+        std::vector<unsigned char> salt = g_insecure_rand_ctx.randbytes(32);
+        std::vector<unsigned char> expected(32), out(32);
+        BOOST_CHECK_EQUAL(LYRA2(expected.data(), 32, pwd.data(), 32, salt.data(), 32, 1, 4, 4), 0);
+        LYRA2_4x4(out.data(), 32, pwd.data(), 32, salt.data(), 32, 1);
+        BOOST_CHECK(out == expected);
+        BOOST_CHECK_EQUAL(LYRA2_old(expected.data(), 32, pwd.data(), 32, salt.data(), 32, 1, 8, 8), 0);
+        LYRA2_old_8x8(out.data(), 32, pwd.data(), 32, salt.data(), 32, 1);
+        BOOST_CHECK(out == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(bmw256_testvectors) {
+    // The bit count is part of the last block, so these cover bmw32_close writing it. The values
+    // are those of sphlib built without optimization, or with -fno-strict-aliasing.
+    TestBMW256("", "82cac4bf6f4c2b41fbcc0e0984e9d8b76d7662f8e1789cdfbd85682acc55577a");
+    TestBMW256("616263", "57d11fc94bdf98e6a0d0bf1d4ddda3f4205e873666a644b5bb585e171ad87d34");
+    TestBMW256("0000000000000000000000000000000000000000000000000000000000000000",
+               "ba4756e7820d5ea2c42b662fb95ca1c5089b25b26026ab4c97f9e6634405cb2b");
+    TestBMW256("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f404142434445464748494a4b4c4d4e4f",
+               "57044d8df78b85ff8609e27383a8e4c1b29ca9389e20c2f688a8479bcc8b7a4a");
+}
+
+BOOST_AUTO_TEST_CASE(lyra2_sponge_implementations) {
+    // Every sponge implementation available on this CPU must agree with the generic one.
+    static const enum lyra2_sponge sponges[] = {LYRA2_SPONGE_SSE2, LYRA2_SPONGE_SSSE3, LYRA2_SPONGE_AVX2};
+    static void (*const hashes[])(const char*, char*) = {lyra2re_hash, lyra2re2_hash, lyra2rec0ban_hash};
+    for (int i = 0; i < 8; ++i) {
+        std::vector<unsigned char> in = g_insecure_rand_ctx.randbytes(80);
+        for (auto hash : hashes) {
+            std::vector<unsigned char> expected(32);
+            BOOST_CHECK(Lyra2SelectSponge(LYRA2_SPONGE_GENERIC));
+            hash((const char*)in.data(), (char*)expected.data());
+            for (auto sponge : sponges) {
+                if (!Lyra2SelectSponge(sponge)) continue;
+                std::vector<unsigned char> out(32);
+                hash((const char*)in.data(), (char*)out.data());
+                BOOST_CHECK(out == expected);
+            }
+        }
+    }
+    Lyra2AutoDetect();
+}
+
+BOOST_AUTO_TEST_CASE(pow_hash_batch) {
+    // Cover full 4-header batches as well as the single-header tail.
+    std::vector<CBlockHeader> headers(11);
+    for (CBlockHeader& header : headers) {
+        header.nVersion = InsecureRand32();
+        header.hashPrevBlock = InsecureRand256();
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = InsecureRand32();
+        header.nBits = InsecureRand32();
+        header.nNonce = InsecureRand32();
+    }
+    const bool algos[][2] = {{false, false}, {true, false}, {true, true}};
+    for (const auto& algo : algos) {
+        for (size_t n = 0; n <= headers.size(); ++n) {
+            std::vector<uint256> hashes(n);
+            GetPoWHashBatch(Span<const CBlockHeader>(headers.data(), n), MakeSpan(hashes), algo[0], algo[1]);
+            for (size_t i = 0; i < n; ++i) {
+                BOOST_CHECK(hashes[i] == headers[i].GetPoWHash(algo[0], algo[1]));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(pow_hash_midstate) {
+    // Headers that differ only past the 64 bytes the midstate covers: the end of the merkle root,
+    // the time, the bits and the nonce.
+    CBlockHeader base;
+    base.nVersion = InsecureRand32();
+    base.hashPrevBlock = InsecureRand256();
+    base.hashMerkleRoot = InsecureRand256();
+    const CBlockHeaderMidstate midstate(base);
+    std::vector<CBlockHeader> headers(11, base);
+    for (CBlockHeader& header : headers) {
+        WriteLE32(header.hashMerkleRoot.begin() + 28, InsecureRand32());
+        header.nTime = InsecureRand32();
+        header.nBits = InsecureRand32();
+        header.nNonce = InsecureRand32();
+    }
+    const bool algos[][2] = {{false, false}, {true, false}, {true, true}};
+    for (const auto& algo : algos) {
+        for (const CBlockHeader& header : headers) {
+            BOOST_CHECK(midstate.GetPoWHash(header, algo[0], algo[1]) == header.GetPoWHash(algo[0], algo[1]));
+        }
+        for (size_t n = 0; n <= headers.size(); ++n) {
+            std::vector<uint256> hashes(n);
+            midstate.GetPoWHashBatch(Span<const CBlockHeader>(headers.data(), n), MakeSpan(hashes), algo[0], algo[1]);
+            for (size_t i = 0; i < n; ++i) {
+                BOOST_CHECK(hashes[i] == headers[i].GetPoWHash(algo[0], algo[1]));
+            }
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(aes_testvectors) {
     // AES test vectors from FIPS 197.
     TestAES256("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f", "00112233445566778899aabbccddeeff", "8ea2b7ca516745bfeafc49904b496089");
@@ -750,4 +916,94 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+static MuHash3072 FromInt(unsigned char i)
+{
+    unsigned char data[32] = {i, 0};
+    return MuHash3072().Insert(data, sizeof(data));
+}
+
+BOOST_AUTO_TEST_CASE(muhash_tests)
+{
+    for (int iter = 0; iter < 10; ++iter) {
+        // The hash does not depend on the order of the insertions and removals
+        uint256 first;
+        int table[4];
+        for (int i = 0; i < 4; ++i) {
+            table[i] = InsecureRandBits(3);
+        }
+        for (int order = 0; order < 4; ++order) {
+            MuHash3072 acc;
+            for (int i = 0; i < 4; ++i) {
+                const int t = table[i ^ order];
+                if (t & 4) {
+                    acc /= FromInt(t & 3);
+                } else {
+                    acc *= FromInt(t & 3);
+                }
+            }
+            uint256 out;
+            acc.Finalize(out);
+            if (order == 0) {
+                first = out;
+            } else {
+                BOOST_CHECK(out == first);
+            }
+        }
+
+        // Hashes of parts combine into the hash of the whole, and removing undoes inserting
+        const unsigned char x = InsecureRandBits(4), y = InsecureRandBits(4);
+        MuHash3072 whole = FromInt(x);
+        whole *= FromInt(y);
+        MuHash3072 parts;
+        parts *= FromInt(y);
+        parts *= FromInt(x);
+        uint256 whole_out, parts_out;
+        whole.Finalize(whole_out);
+        parts.Finalize(parts_out);
+        BOOST_CHECK(whole_out == parts_out);
+
+        unsigned char data[32] = {y, 0};
+        whole.Remove(data, sizeof(data));
+        uint256 x_out;
+        FromInt(x).Finalize(x_out);
+        whole.Finalize(whole_out);
+        BOOST_CHECK(whole_out == x_out);
+    }
+
+    // Known answers: the empty set, which hashes the number one, and the one of Bitcoin Core's
+    // MuHash3072 tests, which hashes elements the same way
+    uint256 out;
+    MuHash3072().Finalize(out);
+    BOOST_CHECK_EQUAL(out, uint256S("dd5ad2a105c2d29495f577245c357409002329b9f4d6182c0af3dc2f462555c8"));
+
+    MuHash3072 acc = FromInt(0);
+    acc *= FromInt(1);
+    acc /= FromInt(2);
+    acc.Finalize(out);
+    BOOST_CHECK_EQUAL(out, uint256S("10d312b100cbd32ada024a6646e40d3482fcff103668d2625f10002a607d5863"));
+
+    // The state, with the divisions not done yet, survives serialization
+    CDataStream ss(SER_DISK, 0);
+    ss << acc;
+    BOOST_CHECK_EQUAL(ss.size(), 2 * Num3072::BYTE_SIZE);
+    MuHash3072 acc_read;
+    ss >> acc_read;
+    acc_read *= FromInt(3);
+    acc *= FromInt(3);
+    uint256 out_read;
+    acc.Finalize(out);
+    acc_read.Finalize(out_read);
+    BOOST_CHECK(out == out_read);
+
+    // Inverses of random numbers
+    for (int i = 0; i < 10; ++i) {
+        unsigned char bytes[Num3072::BYTE_SIZE];
+        for (size_t j = 0; j < sizeof(bytes); ++j) bytes[j] = InsecureRandBits(8);
+        Num3072 x(bytes);
+        Num3072 product = x.GetInverse();
+        product.Multiply(x);
+        BOOST_CHECK(product == Num3072());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
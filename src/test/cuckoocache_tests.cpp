@@ -42,6 +42,29 @@ BOOST_AUTO_TEST_CASE(test_cuckoocache_no_fakes)
     }
 };
 
+/* Test that insert only reports a dropped element once the cache is full.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_insert_reports_eviction)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    const uint32_t size = cc.setup_bytes(1 << 20);
+    std::vector<uint256> hashes(size / 4);
+    for (uint256& h : hashes) {
+        h = InsecureRand256();
+        BOOST_CHECK(cc.insert(h));
+    }
+    for (const uint256& h : hashes) {
+        BOOST_CHECK(cc.contains(h, false));
+        BOOST_CHECK(cc.insert(h));
+    }
+    uint32_t dropped = 0;
+    for (uint32_t x = 0; x < 2 * size; ++x) {
+        dropped += !cc.insert(InsecureRand256());
+    }
+    BOOST_CHECK(dropped > 0);
+}
+
 /** This helper returns the hit rate when megabytes*load worth of entries are
  * inserted into a megabytes sized cache
  */
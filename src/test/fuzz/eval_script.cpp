@@ -2,14 +2,40 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <hash.h>
 #include <pubkey.h>
 #include <script/interpreter.h>
 #include <test/fuzz/fuzz.h>
 #include <test/fuzz/FuzzedDataProvider.h>
 #include <util/memory.h>
 
+#include <cassert>
 #include <limits>
 
+namespace {
+/** Accepts signatures whose last byte is odd, so that both outcomes of CHECKSIG get exercised. */
+class FuzzedSignatureChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckSig(const std::vector<unsigned char>& vchSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, uint32_t flags) const override
+    {
+        return !vchSig.empty() && (vchSig.back() & 1);
+    }
+};
+
+/** Check that the interpreter-free path of VerifyScript, where it applies, agrees with the interpreter. */
+void CheckKeyHashSpend(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags)
+{
+    const FuzzedSignatureChecker checker;
+    ScriptError serror;
+    bool result;
+    if (!VerifyKeyHashSpend(scriptSig, scriptPubKey, witness, flags, checker, &serror, result)) return;
+    ScriptError serror_interpreted;
+    assert(VerifyScriptInterpreted(scriptSig, scriptPubKey, &witness, flags, checker, &serror_interpreted) == result);
+    assert(serror == serror_interpreted);
+}
+} // namespace
+
 void initialize()
 {
     static const ECCVerifyHandle verify_handle;
@@ -34,4 +60,23 @@ void test_one_input(const std::vector<uint8_t>& buffer)
         std::vector<std::vector<unsigned char>> stack;
         (void)EvalScript(stack, script, flags, BaseSignatureChecker(), sig_version, nullptr);
     }
+
+    // Spend key hash outputs with the script as scriptSig or, split into its
+    // pushes, as witness, paying to the hash of the last push so that the
+    // key hash usually matches.
+    CScriptWitness witness;
+    CScript::const_iterator pc = script.begin();
+    opcodetype opcode;
+    std::vector<unsigned char> push;
+    while (script.GetOp(pc, opcode, push)) {
+        witness.stack.push_back(push);
+    }
+    std::vector<unsigned char> keyhash(20);
+    const std::vector<unsigned char>& pubkey = witness.stack.empty() ? script_bytes : witness.stack.back();
+    CHash160().Write(pubkey.data(), pubkey.size()).Finalize(keyhash.data());
+    const CScript p2pkh = CScript() << OP_DUP << OP_HASH160 << keyhash << OP_EQUALVERIFY << OP_CHECKSIG;
+    const CScript p2wpkh = CScript() << OP_0 << keyhash;
+    CheckKeyHashSpend(script, p2pkh, witness, flags);
+    CheckKeyHashSpend(script, p2pkh, CScriptWitness(), flags);
+    CheckKeyHashSpend(CScript(), p2wpkh, witness, flags);
 }
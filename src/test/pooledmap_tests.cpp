@@ -0,0 +1,179 @@
+// Copyright (c) 2017-2021 The c0ban Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <pooledmap.h>
+
+#include <test/util/setup_common.h>
+
+#include <memory>
+#include <unordered_map>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pooledmap_tests, BasicTestingSetup)
+
+namespace {
+struct MixHasher {
+    size_t operator()(uint32_t key) const { return (key + 1) * uint64_t{0x9e3779b97f4a7c15}; }
+};
+
+/** Puts all keys in a few long clusters, to exercise probing and erasing in the middle of clusters. */
+struct CollidingHasher {
+    size_t operator()(uint32_t key) const { return key % 3; }
+};
+
+/** Element that counts how many of its kind are alive. */
+struct Tracked {
+    std::shared_ptr<int> counter;
+    int value{0};
+    Tracked() {}
+    Tracked(const std::shared_ptr<int>& counter_, int value_) : counter(counter_), value(value_) { ++*counter; }
+    Tracked(Tracked&& other) : counter(std::move(other.counter)), value(other.value) {}
+    Tracked& operator=(Tracked&& other)
+    {
+        if (counter) --*counter;
+        counter = std::move(other.counter);
+        value = other.value;
+        return *this;
+    }
+    ~Tracked() { if (counter) --*counter; }
+};
+
+template <typename Hash>
+void CheckEqual(const pooledmap<uint32_t, Tracked, Hash>& map, const std::unordered_map<uint32_t, int>& expected)
+{
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    size_t iterated = 0;
+    for (const auto& entry : map) {
+        auto it = expected.find(entry.first);
+        BOOST_REQUIRE(it != expected.end());
+        BOOST_CHECK_EQUAL(entry.second.value, it->second);
+        ++iterated;
+    }
+    BOOST_CHECK_EQUAL(iterated, expected.size());
+    for (const auto& entry : expected) {
+        auto it = map.find(entry.first);
+        BOOST_REQUIRE(it != map.end());
+        BOOST_CHECK_EQUAL(it->second.value, entry.second);
+    }
+}
+
+/** Random inserts, lookups and erases, compared against a std::unordered_map. */
+template <typename Hash>
+void RandomOperations(uint32_t key_range)
+{
+    auto counter = std::make_shared<int>(0);
+    std::unordered_map<uint32_t, int> expected;
+    {
+        pooledmap<uint32_t, Tracked, Hash> map;
+        for (int i = 0; i < 20000; ++i) {
+            const uint32_t key = InsecureRandRange(key_range);
+            const int value = InsecureRand32();
+            switch (InsecureRandRange(4)) {
+            case 0:
+            case 1: {
+                auto result = map.try_emplace(key, counter, value);
+                BOOST_CHECK_EQUAL(result.second, expected.emplace(key, value).second);
+                BOOST_CHECK_EQUAL(result.first->first, key);
+                BOOST_CHECK_EQUAL(result.first->second.value, expected[key]);
+                break;
+            }
+            case 2:
+                BOOST_CHECK_EQUAL(map.erase(key), expected.erase(key));
+                break;
+            case 3: {
+                auto it = map.find(key);
+                BOOST_CHECK_EQUAL(it != map.end(), expected.count(key) != 0);
+                if (it != map.end()) BOOST_CHECK_EQUAL(it->second.value, expected[key]);
+                break;
+            }
+            }
+            BOOST_CHECK_EQUAL(*counter, (int)map.size());
+            if (i % 5000 == 4999) CheckEqual(map, expected);
+        }
+        CheckEqual(map, expected);
+
+        map.clear();
+        expected.clear();
+        BOOST_CHECK(map.empty());
+        BOOST_CHECK(map.begin() == map.end());
+        BOOST_CHECK_EQUAL(*counter, 0);
+        BOOST_CHECK_EQUAL(map.chunk_count(), 0U);
+
+        for (uint32_t key = 0; key < key_range; key += 2) {
+            map.try_emplace(key, counter, key);
+            expected.emplace(key, key);
+        }
+        CheckEqual(map, expected);
+    }
+    // Destroying the map destroys its elements
+    BOOST_CHECK_EQUAL(*counter, 0);
+}
+} // namespace
+
+BOOST_AUTO_TEST_CASE(pooledmap_random)
+{
+    RandomOperations<MixHasher>(1000);
+    RandomOperations<MixHasher>(100000);
+    RandomOperations<CollidingHasher>(300);
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_erase_while_iterating)
+{
+    auto counter = std::make_shared<int>(0);
+    pooledmap<uint32_t, Tracked, MixHasher> map;
+    std::unordered_map<uint32_t, int> expected;
+    for (uint32_t key = 0; key < 1000; ++key) {
+        map.try_emplace(key, counter, key);
+    }
+    // Erase the odd keys, visiting every element once
+    size_t visited = 0;
+    for (auto it = map.begin(); it != map.end();) {
+        ++visited;
+        if (it->first % 2) {
+            it = map.erase(it);
+        } else {
+            expected.emplace(it->first, it->second.value);
+            ++it;
+        }
+    }
+    BOOST_CHECK_EQUAL(visited, 1000U);
+    CheckEqual(map, expected);
+    BOOST_CHECK_EQUAL(*counter, 500);
+
+    // Freed positions are reused before the pool grows
+    const size_t chunks = map.chunk_count();
+    for (uint32_t key = 1000; key < 1500; ++key) {
+        map.try_emplace(key, counter, key);
+    }
+    BOOST_CHECK_EQUAL(map.chunk_count(), chunks);
+    BOOST_CHECK_EQUAL(*counter, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(pooledmap_stable_references)
+{
+    pooledmap<uint32_t, int, MixHasher> map;
+    std::vector<std::pair<const uint32_t, int>*> elements;
+    for (uint32_t key = 0; key < 100; ++key) {
+        elements.push_back(&*map.try_emplace(key, key).first);
+    }
+    // Growing the index and the pool does not move elements
+    for (uint32_t key = 100; key < 10000; ++key) {
+        map[key] = key;
+    }
+    for (uint32_t key = 0; key < 100; key += 2) {
+        map.erase(key);
+    }
+    for (uint32_t key = 1; key < 100; key += 2) {
+        BOOST_CHECK(&*map.find(key) == elements[key]);
+        BOOST_CHECK_EQUAL(elements[key]->second, (int)key);
+    }
+
+    // The accounted memory covers the elements, and not much more
+    BOOST_CHECK(memusage::DynamicUsage(map) >= map.size() * sizeof(std::pair<const uint32_t, int>));
+    BOOST_CHECK(memusage::DynamicUsage(map) < map.size() * 64);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -66,7 +66,7 @@ BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_negative_target)
     unsigned int nBits;
     nBits = UintToArith256(consensus.powLimit).GetCompact(true);
     hash.SetHex("0x1");
-    BOOST_CHECK(!CheckProofOfWork(hash, nBits, consensus));
+    BOOST_CHECK(!CheckProofOfWork(hash, nBits, false, consensus));
 }
 
 BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_overflow_target)
@@ -75,7 +75,7 @@ BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_overflow_target)
     uint256 hash;
     unsigned int nBits = ~0x00800000;
     hash.SetHex("0x1");
-    BOOST_CHECK(!CheckProofOfWork(hash, nBits, consensus));
+    BOOST_CHECK(!CheckProofOfWork(hash, nBits, false, consensus));
 }
 
 BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_too_easy_target)
@@ -87,7 +87,7 @@ BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_too_easy_target)
     nBits_arith *= 2;
     nBits = nBits_arith.GetCompact();
     hash.SetHex("0x1");
-    BOOST_CHECK(!CheckProofOfWork(hash, nBits, consensus));
+    BOOST_CHECK(!CheckProofOfWork(hash, nBits, false, consensus));
 }
 
 BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_biger_hash_than_target)
@@ -99,7 +99,7 @@ BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_biger_hash_than_target)
     nBits = hash_arith.GetCompact();
     hash_arith *= 2; // hash > nBits
     hash = ArithToUint256(hash_arith);
-    BOOST_CHECK(!CheckProofOfWork(hash, nBits, consensus));
+    BOOST_CHECK(!CheckProofOfWork(hash, nBits, false, consensus));
 }
 
 BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_zero_target)
@@ -110,7 +110,7 @@ BOOST_AUTO_TEST_CASE(CheckProofOfWork_test_zero_target)
     arith_uint256 hash_arith{0};
     nBits = hash_arith.GetCompact();
     hash = ArithToUint256(hash_arith);
-    BOOST_CHECK(!CheckProofOfWork(hash, nBits, consensus));
+    BOOST_CHECK(!CheckProofOfWork(hash, nBits, false, consensus));
 }
 
 BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
@@ -135,4 +135,98 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+/* LWMA and LWMA-1 as computed before the rolling window, walking the window with GetAncestor */
+static unsigned int ReferenceLwma(const CBlockIndex* pindexLast, const Consensus::Params& params)
+{
+    const int FTL = MAX_FUTURE_BLOCK_TIME;
+    const int T = params.nPowTargetSpacing;
+    const int N = Params().AveragingWindow();
+    const int k = N*(N+1)*T/2;
+    const int height = pindexLast->nHeight;
+
+    arith_uint256 sum_target;
+    int t = 0, j = 0, solvetime;
+    for (int i = height - N+1; i <= height; i++) {
+        const CBlockIndex* block = pindexLast->GetAncestor(i);
+        const CBlockIndex* block_Prev = block->GetAncestor(i - 1);
+        solvetime = block->GetBlockTime() - block_Prev->GetBlockTime();
+        solvetime = std::max(-FTL, std::min(solvetime, 6*T));
+        j++;
+        t += solvetime * j;
+        arith_uint256 target;
+        target.SetCompact(block->nBits);
+        sum_target += target / (k * N);
+    }
+    if (t < k/10 ) {
+        t = k/10;
+    }
+    arith_uint256 next_target = t * sum_target;
+    return next_target.GetCompact();
+}
+
+static unsigned int ReferenceLwma1(const CBlockIndex* pindexLast, const Consensus::Params& params)
+{
+    const int64_t T = params.nPowTargetSpacing;
+    const int64_t N = Params().AveragingWindow();
+    const int64_t k = N * (N + 1) * T / 2;
+    const int64_t height = pindexLast->nHeight;
+    const arith_uint256 powLimit = UintToArith256(params.powLimit);
+
+    arith_uint256 avgTarget, nextTarget;
+    int64_t thisTimestamp, previousTimestamp;
+    int64_t sumWeightedSolvetimes = 0, j = 0;
+    previousTimestamp = pindexLast->GetAncestor(height - N)->GetBlockTime();
+    for (int64_t i = height - N + 1; i <= height; i++) {
+        const CBlockIndex* block = pindexLast->GetAncestor(i);
+        thisTimestamp = (block->GetBlockTime() > previousTimestamp) ? block->GetBlockTime() : previousTimestamp + 1;
+        int64_t solvetime = std::min(6 * T, thisTimestamp - previousTimestamp);
+        previousTimestamp = thisTimestamp;
+        j++;
+        sumWeightedSolvetimes += solvetime * j;
+        arith_uint256 target;
+        target.SetCompact(block->nBits);
+        avgTarget += target / N / k;
+    }
+    nextTarget = avgTarget * sumWeightedSolvetimes;
+    if (nextTarget > powLimit) {
+        nextTarget = powLimit;
+    }
+    return nextTarget.GetCompact();
+}
+
+/* The rolling LWMA window must agree with a full walk when advancing, reorging and jumping around */
+BOOST_AUTO_TEST_CASE(lwma_rolling_window_matches_full_walk)
+{
+    const Consensus::Params& params = Params().GetConsensus();
+    const int64_t T = params.nPowTargetSpacing;
+    const arith_uint256 pow_limit = UintToArith256(params.powLimit);
+
+    // A main chain and a branch forking off it, with solvetimes that are sometimes negative or
+    // longer than the 6T cap.
+    const int MAIN_LENGTH = 400, FORK_POINT = 300, FORK_LENGTH = 150;
+    std::vector<CBlockIndex> blocks(MAIN_LENGTH + FORK_LENGTH);
+    std::vector<uint256> hashes(blocks.size());
+    for (size_t i = 0; i < blocks.size(); i++) {
+        CBlockIndex* prev = i == 0 ? nullptr : i == MAIN_LENGTH ? &blocks[FORK_POINT] : &blocks[i - 1];
+        hashes[i] = InsecureRand256();
+        blocks[i].phashBlock = &hashes[i];
+        blocks[i].pprev = prev;
+        blocks[i].nHeight = prev ? prev->nHeight + 1 : 0;
+        const int64_t solvetime = InsecureRandBool() ? InsecureRandRange(2 * T) + 1 : InsecureRandRange(10 * T) - 3 * T;
+        blocks[i].nTime = prev ? prev->nTime + solvetime : 1500000000;
+        blocks[i].nBits = arith_uint256(pow_limit >> InsecureRandRange(24)).GetCompact();
+        blocks[i].BuildSkip();
+    }
+
+    const int N = Params().AveragingWindow();
+    auto check = [&](const CBlockIndex* tip) {
+        BOOST_CHECK_EQUAL(LwmaGetNextWorkRequired(tip, nullptr, params), ReferenceLwma(tip, params));
+        BOOST_CHECK_EQUAL(Lwma1CalculateNextWorkRequired(tip, params), ReferenceLwma1(tip, params));
+    };
+    for (int i = N + 1; i < MAIN_LENGTH; i++) check(&blocks[i]);
+    for (int i = MAIN_LENGTH; i < MAIN_LENGTH + FORK_LENGTH; i++) check(&blocks[i]);
+    for (int i = FORK_POINT - N; i < MAIN_LENGTH; i++) check(&blocks[i]);
+    for (int i = 0; i < 500; i++) check(&blocks[N + 1 + InsecureRandRange(blocks.size() - N - 1)]);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
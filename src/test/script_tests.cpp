@@ -12,6 +12,7 @@
 #include <script/signingprovider.h>
 #include <util/system.h>
 #include <util/strencodings.h>
+#include <test/util/json.h>
 #include <test/util/transaction_utils.h>
 #include <test/util/setup_common.h>
 #include <rpc/util.h>
@@ -37,19 +38,6 @@ static const unsigned int gFlags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_STRICTENC;
 unsigned int ParseScriptFlags(std::string strFlags);
 std::string FormatScriptFlags(unsigned int flags);
 
-UniValue
-read_json(const std::string& jsondata)
-{
-    UniValue v;
-
-    if (!v.read(jsondata) || !v.isArray())
-    {
-        BOOST_ERROR("Parse error.");
-        return UniValue(UniValue::VARR);
-    }
-    return v.get_array();
-}
-
 struct ScriptErrorDesc
 {
     ScriptError_t err;
@@ -10,6 +10,7 @@
 #include <script/script.h>
 #include <serialize.h>
 #include <streams.h>
+#include <test/util/json.h>
 #include <test/util/setup_common.h>
 #include <util/system.h>
 #include <util/strencodings.h>
@@ -21,8 +22,6 @@
 
 #include <univalue.h>
 
-extern UniValue read_json(const std::string& jsondata);
-
 // Old script.cpp SignatureHash function
 uint256 static SignatureHashOld(CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
 {
@@ -135,7 +134,7 @@ BOOST_AUTO_TEST_CASE(sighash_test)
 
         uint256 sh, sho;
         sho = SignatureHashOld(scriptCode, CTransaction(txTo), nIn, nHashType);
-        sh = SignatureHash(scriptCode, txTo, nIn, nHashType, 0, SigVersion::BASE);
+        sh = SignatureHash(scriptCode, txTo, nIn, SigHashType(nHashType), 0, SigVersion::BASE);
         #if defined(PRINT_SIGHASH_JSON)
         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
         ss << txTo;
@@ -201,8 +200,35 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
           continue;
         }
 
-        sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SigVersion::BASE);
+        sh = SignatureHash(scriptCode, *tx, nIn, SigHashType(nHashType), 0, SigVersion::BASE);
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
+
+// Goal: check that the precomputed legacy parts give the same hashes as serializing the transaction
+BOOST_AUTO_TEST_CASE(sighash_legacy_precomputed)
+{
+    for (int i = 0; i < 2000; i++) {
+        const uint32_t nHashType = InsecureRand32();
+        const uint32_t flags = InsecureRandBool() ? SCRIPT_ENABLE_REPLAY_PROTECTION : 0;
+        CMutableTransaction txTo;
+        RandomTransaction(txTo, (nHashType & 0x1f) == SIGHASH_SINGLE);
+        // Sometimes more inputs and outputs than SIGHASH_SINGLE can sign, to hash UINT256_ONE
+        for (int extra = InsecureRandBits(3); extra > 0; extra--) {
+            txTo.vin.push_back(txTo.vin[InsecureRandRange(txTo.vin.size())]);
+            txTo.vin.back().prevout.n = InsecureRand32();
+        }
+        const CTransaction tx(txTo);
+        const PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK_EQUAL(txdata.legacy_ready, tx.vin.size() > 1);
+
+        CScript scriptCode;
+        RandomScript(scriptCode);
+        for (unsigned int nIn = 0; nIn < tx.vin.size(); nIn++) {
+            const uint256 sh = SignatureHash(scriptCode, tx, nIn, SigHashType(nHashType), 0, SigVersion::BASE, nullptr, flags);
+            const uint256 shc = SignatureHash(scriptCode, tx, nIn, SigHashType(nHashType), 0, SigVersion::BASE, &txdata, flags);
+            BOOST_CHECK(sh == shc);
+        }
+    }
+}
 BOOST_AUTO_TEST_SUITE_END()
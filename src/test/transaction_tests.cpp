@@ -4,6 +4,7 @@
 
 #include <test/data/tx_invalid.json.h>
 #include <test/data/tx_valid.json.h>
+#include <test/util/json.h>
 #include <test/util/setup_common.h>
 
 #include <clientversion.h>
@@ -35,9 +36,6 @@
 
 typedef std::vector<unsigned char> valtype;
 
-// In script_tests.cpp
-extern UniValue read_json(const std::string& jsondata);
-
 static std::map<std::string, unsigned int> mapFlagNames = {
     {std::string("NONE"), (unsigned int)SCRIPT_VERIFY_NONE},
     {std::string("P2SH"), (unsigned int)SCRIPT_VERIFY_P2SH},
@@ -3,13 +3,18 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <validation.h>
+#include <coins.h>
 #include <consensus/validation.h>
+#include <policy/policy.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
 #include <test/util/setup_common.h>
 
 #include <boost/test/unit_test.hpp>
 
+bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const CCoinsViewCache &inputs, unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks);
 
 BOOST_AUTO_TEST_SUITE(txvalidation_tests)
 
@@ -52,4 +57,51 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK(state.GetResult() == TxValidationResult::TX_CONSENSUS);
 }
 
+/**
+ * Ensure that the scripts of a transaction with many inputs, which are checked
+ * on the script check threads, pass, and that a failing input is still reported.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_check_input_scripts_parallel, TestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    const CScript scriptPubKey = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    FillableSigningProvider keystore;
+    BOOST_CHECK(keystore.AddKey(key));
+
+    const unsigned int num_inputs = 20;
+    CCoinsView view_dummy;
+    CCoinsViewCache view(&view_dummy);
+    CMutableTransaction spend;
+    for (unsigned int i = 0; i < num_inputs; i++) {
+        const COutPoint prevout(InsecureRand256(), 0);
+        view.AddCoin(prevout, Coin(CTxOut(CENT, scriptPubKey), 1, false), false);
+        spend.vin.emplace_back(prevout);
+    }
+    spend.vout.emplace_back(num_inputs * CENT, scriptPubKey);
+    const unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS | SCRIPT_ENABLE_REPLAY_PROTECTION;
+    for (unsigned int i = 0; i < num_inputs; i++) {
+        SignatureData sigdata;
+        BOOST_CHECK(ProduceSignature(keystore, MutableTransactionSignatureCreator(&spend, i, CENT, SigHashType().withForkId(), flags), scriptPubKey, sigdata));
+        UpdateInput(spend.vin[i], sigdata);
+    }
+    // A signature for another input has a valid encoding, but fails
+    CMutableTransaction bad_spend(spend);
+    bad_spend.vin.back().scriptSig = bad_spend.vin.front().scriptSig;
+
+    LOCK(cs_main);
+
+    const CTransaction tx(spend);
+    PrecomputedTransactionData txdata(tx);
+    TxValidationState state;
+    BOOST_CHECK(CheckInputScripts(tx, state, view, flags, true, false, txdata, nullptr));
+    BOOST_CHECK(state.IsValid());
+
+    const CTransaction bad_tx(bad_spend);
+    PrecomputedTransactionData bad_txdata(bad_tx);
+    BOOST_CHECK(!CheckInputScripts(bad_tx, state, view, flags, true, false, bad_txdata, nullptr));
+    BOOST_CHECK(state.GetResult() == TxValidationResult::TX_CONSENSUS);
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "mandatory-script-verify-flag-failed (Signature must be zero for failed CHECK(MULTI)SIG operation)");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
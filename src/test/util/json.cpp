@@ -0,0 +1,16 @@
+// Copyright (c) 2011-2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <test/util/json.h>
+
+#include <stdexcept>
+
+UniValue read_json(const std::string& jsondata)
+{
+    UniValue v;
+    if (!v.read(jsondata) || !v.isArray()) {
+        throw std::runtime_error("Parse error.");
+    }
+    return v.get_array();
+}
@@ -26,7 +26,10 @@ CTxIn MineBlock(const NodeContext& node, const CScript& coinbase_scriptPubKey)
 {
     auto block = PrepareBlock(node, coinbase_scriptPubKey);
 
-    while (!CheckProofOfWork(block->GetHash(), block->nBits, Params().GetConsensus())) {
+    const int nHeight = WITH_LOCK(cs_main, return ::ChainActive().Height()) + 1;
+    const bool isPostFork = nHeight >= Params().SwitchLyra2REv2_LWMA();
+    const bool isPostForkLyra2C0ban = nHeight >= Params().SwitchLyra2REvc0ban_LWMA();
+    while (!CheckProofOfWork(block->GetPoWHash(isPostFork, isPostForkLyra2C0ban), block->nBits, isPostFork, Params().GetConsensus())) {
         ++block->nNonce;
         assert(block->nNonce);
     }
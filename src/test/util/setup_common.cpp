@@ -9,6 +9,7 @@
 #include <consensus/consensus.h>
 #include <consensus/params.h>
 #include <consensus/validation.h>
+#include <crypto/Lyra2RE/Lyra2RE.h>
 #include <crypto/sha256.h>
 #include <init.h>
 #include <miner.h>
@@ -76,6 +77,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
     InitLogging();
     LogInstance().StartLogging();
     SHA256AutoDetect();
+    Lyra2AutoDetect();
     ECC_Start();
     SetupEnvironment();
     SetupNetworking();
@@ -201,7 +203,10 @@ CBlock TestChain100Setup::CreateAndProcessBlock(const std::vector<CMutableTransa
         IncrementExtraNonce(&block, ::ChainActive().Tip(), extraNonce);
     }
 
-    while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+    const int nHeight = WITH_LOCK(cs_main, return ::ChainActive().Height()) + 1;
+    const bool isPostFork = nHeight >= chainparams.SwitchLyra2REv2_LWMA();
+    const bool isPostForkLyra2C0ban = nHeight >= chainparams.SwitchLyra2REvc0ban_LWMA();
+    while (!CheckProofOfWork(block.GetPoWHash(isPostFork, isPostForkLyra2C0ban), block.nBits, isPostFork, chainparams.GetConsensus())) ++block.nNonce;
 
     std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(block);
     ProcessNewBlock(chainparams, shared_pblock, true, nullptr);
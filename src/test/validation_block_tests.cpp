@@ -100,7 +100,9 @@ std::shared_ptr<CBlock> MinerTestingSetup::FinalizeBlock(std::shared_ptr<CBlock>
 
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 
-    while (!CheckProofOfWork(pblock->GetHash(), pblock->nBits, Params().GetConsensus())) {
+    // The parent may not be in the block index yet, but on regtest every block after the genesis
+    // block is mined with the current algorithm
+    while (!CheckProofOfWork(pblock->GetPoWHash(true, true), pblock->nBits, true, Params().GetConsensus())) {
         ++(pblock->nNonce);
     }
 
@@ -3,8 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <consensus/consensus.h>
+#include <consensus/validation.h>
 #include <net.h>
+#include <pow.h>
 #include <validation.h>
+#include <validationinterface.h>
 
 #include <test/util/setup_common.h>
 
@@ -74,4 +78,125 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+/** A block of a coinbase and a transaction spending each of the given outputs. */
+static CBlock MakeBlock(const std::vector<COutPoint>& prevouts)
+{
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript() << OP_0 << OP_0;
+    coinbase.vout.emplace_back(50 * COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    for (const COutPoint& prevout : prevouts) {
+        CMutableTransaction tx;
+        tx.vin.emplace_back(prevout);
+        tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+        block.vtx.push_back(MakeTransactionRef(tx));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(checkblock_transactions)
+{
+    // Large enough for the transactions to be checked on the block transaction checking threads
+    std::vector<COutPoint> prevouts;
+    for (uint32_t i = 0; i < 100; ++i) {
+        prevouts.emplace_back(InsecureRand256(), i);
+    }
+    LOCK(cs_main);
+    const Consensus::Params& params = Params().GetConsensus();
+
+    BlockValidationState state;
+    BOOST_CHECK(CheckBlock(MakeBlock(prevouts), state, params, false, false));
+    state = BlockValidationState();
+
+    // The first invalid transaction is reported
+    CMutableTransaction duplicate_inputs;
+    duplicate_inputs.vin = {CTxIn(prevouts[60]), CTxIn(prevouts[60])};
+    duplicate_inputs.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    CMutableTransaction negative_output;
+    negative_output.vin.emplace_back(prevouts[80]);
+    negative_output.vout.emplace_back(-1, CScript() << OP_TRUE);
+    CBlock block = MakeBlock(prevouts);
+    block.vtx[61] = MakeTransactionRef(duplicate_inputs);
+    block.vtx[81] = MakeTransactionRef(negative_output);
+    BOOST_CHECK(!CheckBlock(block, state, params, false, false));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-txns-inputs-duplicate");
+    BOOST_CHECK(state.GetDebugMessage().find(block.vtx[61]->GetHash().ToString()) != std::string::npos);
+
+    // Sigops of all transactions are counted
+    const size_t sigops_per_tx = MAX_BLOCK_SIGOPS_COST / WITNESS_SCALE_FACTOR / prevouts.size();
+    for (const size_t sigops : {sigops_per_tx, sigops_per_tx + 1}) {
+        block = MakeBlock(prevouts);
+        for (size_t i = 1; i < block.vtx.size(); ++i) {
+            CMutableTransaction tx(*block.vtx[i]);
+            for (size_t j = 0; j < sigops; ++j) tx.vout[0].scriptPubKey << OP_CHECKSIG;
+            block.vtx[i] = MakeTransactionRef(tx);
+        }
+        state = BlockValidationState();
+        BOOST_CHECK_EQUAL(CheckBlock(block, state, params, false, false), sigops == sigops_per_tx);
+    }
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "bad-blk-sigops");
+}
+
+BOOST_FIXTURE_TEST_CASE(headers_bad_pow, RegTestingSetup)
+{
+    // A header failing its target is rejected along with the rest of the message, but the headers before it are accepted.
+    // The headers stay within the first AveragingWindow() heights, whose difficulty is fixed at the PoW limit.
+    const CChainParams& chainparams = Params();
+    const CBlock& genesis = chainparams.GenesisBlock();
+    std::vector<CBlockHeader> headers;
+    uint256 prev = genesis.GetHash();
+    for (int i = 0; i < chainparams.AveragingWindow(); ++i) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = prev;
+        header.nTime = genesis.nTime + chainparams.GetConsensus().nPowTargetSpacing * (i + 1);
+        header.nBits = genesis.nBits;
+        const bool valid_pow = i != 5;
+        while (CheckProofOfWork(header.GetPoWHash(true, true), header.nBits, true, chainparams.GetConsensus()) != valid_pow) ++header.nNonce;
+        headers.push_back(header);
+        prev = header.GetHash();
+    }
+
+    BlockValidationState state;
+    const CBlockIndex* pindex = nullptr;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, chainparams, &pindex));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    LOCK(cs_main);
+    for (size_t i = 0; i < headers.size(); ++i) {
+        BOOST_CHECK_EQUAL(LookupBlockIndex(headers[i].GetHash()) != nullptr, i < 5);
+    }
+    BOOST_CHECK(pindex && pindex->GetBlockHash() == headers[4].GetHash());
+}
+
+namespace {
+struct BlockCheckedRecorder : public CValidationInterface {
+    BlockValidationState state;
+    void BlockChecked(const CBlock&, const BlockValidationState& state_in) override { state = state_in; }
+};
+} // namespace
+
+BOOST_FIXTURE_TEST_CASE(processnewblock_header_first, RegTestingSetup)
+{
+    // A block failing its proof of work is rejected for it, although its contents (no
+    // transactions at all) are invalid too
+    const CChainParams& chainparams = Params();
+    const CBlock& genesis = chainparams.GenesisBlock();
+    auto block = std::make_shared<CBlock>();
+    block->nVersion = 4;
+    block->hashPrevBlock = genesis.GetHash();
+    block->nTime = genesis.nTime + chainparams.GetConsensus().nPowTargetSpacing;
+    block->nBits = genesis.nBits;
+    while (CheckProofOfWork(block->GetPoWHash(true, true), block->nBits, true, chainparams.GetConsensus())) ++block->nNonce;
+
+    BlockCheckedRecorder recorder;
+    RegisterValidationInterface(&recorder);
+    BOOST_CHECK(!ProcessNewBlock(chainparams, block, true, nullptr));
+    UnregisterValidationInterface(&recorder);
+    BOOST_CHECK_EQUAL(recorder.state.GetRejectReason(), "high-hash");
+    BOOST_CHECK(!WITH_LOCK(cs_main, return block->fChecked));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
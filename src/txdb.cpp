@@ -6,12 +6,15 @@
 
 #include <txdb.h>
 
+#include <chainparams.h>
 #include <pow.h>
 #include <random.h>
 #include <shutdown.h>
 #include <ui_interface.h>
 #include <uint256.h>
+#include <logging/timer.h>
 #include <util/system.h>
+#include <util/threadnames.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
@@ -23,6 +26,7 @@ static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_BLOCK_POW_HASH = 'p';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_HEAD_BLOCKS = 'H';
@@ -58,15 +62,42 @@ CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, b
 {
 }
 
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (m_writer.joinable()) m_writer.join();
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(m_writing_mutex);
+        CCoinsMap::const_iterator it = m_writing.find(outpoint);
+        if (it != m_writing.end()) {
+            if (it->second.coin.IsSpent()) return false;
+            coin = it->second.coin;
+            return true;
+        }
+    }
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(m_writing_mutex);
+        CCoinsMap::const_iterator it = m_writing.find(outpoint);
+        if (it != m_writing.end()) return !it->second.coin.IsSpent();
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        LOCK(m_writing_mutex);
+        if (!m_writing_block.IsNull()) return m_writing_block;
+    }
+    return ReadBestBlock();
+}
+
+uint256 CCoinsViewDB::ReadBestBlock() const {
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -82,6 +113,77 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
 }
 
 bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    {
+        WAIT_LOCK(m_writing_mutex, lock);
+        m_writing_cv.wait(lock, [this] { return !m_writer_running; });
+        if (m_write_failed) return false;
+        // Marked like a background write, so that Cursors does not snapshot it halfway
+        m_writer_running = true;
+    }
+    bool ret;
+    try {
+        ret = WriteCoins(mapCoins, hashBlock, true);
+    } catch (...) {
+        WITH_LOCK(m_writing_mutex, m_writer_running = false);
+        m_writing_cv.notify_all();
+        throw;
+    }
+    WITH_LOCK(m_writing_mutex, m_writer_running = false);
+    m_writing_cv.notify_all();
+    return ret;
+}
+
+bool CCoinsViewDB::BatchWriteInBackground(CCoinsMap& mapCoins, const uint256& hashBlock, std::function<void(bool)> done)
+{
+    if (!WaitForBackgroundWrite()) return false;
+    if (m_writer.joinable()) m_writer.join();
+    {
+        LOCK(m_writing_mutex);
+        m_writing.swap(mapCoins);
+        m_writing_block = hashBlock;
+        m_writer_running = true;
+    }
+    m_writer = std::thread(&CCoinsViewDB::BackgroundWrite, this, hashBlock, std::move(done));
+    return true;
+}
+
+void CCoinsViewDB::BackgroundWrite(uint256 hashBlock, std::function<void(bool)> done)
+{
+    util::ThreadRename("coinswrite");
+    bool ok = false;
+    try {
+        LOG_TIME_SECONDS(strprintf("write %u coins to disk in background", m_writing.size()));
+        ok = WriteCoins(m_writing, hashBlock, false);
+    } catch (const std::runtime_error& e) {
+        LogPrintf("Error writing coins in background: %s\n", e.what());
+    }
+    if (ok) {
+        // Give back the memory outside of the lock. After a failure the
+        // database is behind, so the coins keep answering reads.
+        CCoinsMap written;
+        {
+            LOCK(m_writing_mutex);
+            written.swap(m_writing);
+            m_writing_block.SetNull();
+        }
+    }
+    done(ok);
+    {
+        LOCK(m_writing_mutex);
+        m_write_failed = !ok;
+        m_writer_running = false;
+    }
+    m_writing_cv.notify_all();
+}
+
+bool CCoinsViewDB::WaitForBackgroundWrite() const
+{
+    WAIT_LOCK(m_writing_mutex, lock);
+    m_writing_cv.wait(lock, [this] { return !m_writer_running; });
+    return !m_write_failed;
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase) {
     CDBBatch batch(db);
     size_t count = 0;
     size_t changed = 0;
@@ -89,7 +191,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = ReadBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -116,8 +218,11 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (erase) {
+            it = mapCoins.erase(it);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -171,22 +276,55 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
 
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    // The cursor iterates the database, which must have all coins
+    WaitForBackgroundWrite();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
     i->pcursor->Seek(DB_COIN);
     // Cache key of first record
-    if (i->pcursor->Valid()) {
-        CoinEntry entry(&i->keyTmp.second);
-        i->pcursor->GetKey(entry);
-        i->keyTmp.first = entry.key;
-    } else {
-        i->keyTmp.first = 0; // Make sure Valid() and GetKey() return false
-    }
+    i->ReadKey();
     return i;
 }
 
+std::vector<std::unique_ptr<CCoinsViewCursor>> CCoinsViewDB::Cursors(int count) const
+{
+    assert(count >= 1 && count <= 256);
+    CDBWrapper& wrapper = const_cast<CDBWrapper&>(db);
+    std::shared_ptr<const leveldb::Snapshot> snapshot;
+    {
+        // Writes are marked running under the lock before they start, so none is in progress
+        // while it is held
+        WAIT_LOCK(m_writing_mutex, lock);
+        m_writing_cv.wait(lock, [this] { return !m_writer_running; });
+        snapshot = wrapper.GetSnapshot();
+    }
+
+    // The best block as of the snapshot, which is only missing if a write was interrupted
+    uint256 hashBlock;
+    {
+        std::unique_ptr<CDBIterator> it(wrapper.NewIterator(snapshot));
+        it->Seek(DB_BEST_BLOCK);
+        char key;
+        if (!it->Valid() || !it->GetKey(key) || key != DB_BEST_BLOCK || !it->GetValue(hashBlock)) {
+            return {};
+        }
+    }
+
+    std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
+    for (int i = 0; i < count; ++i) {
+        CCoinsViewDBCursor* cursor = new CCoinsViewDBCursor(wrapper.NewIterator(snapshot), hashBlock, 256 * (i + 1) / count);
+        cursors.emplace_back(cursor);
+        uint256 start;
+        *start.begin() = 256 * i / count;
+        const COutPoint first(start, 0);
+        cursor->pcursor->Seek(CoinEntry(&first));
+        cursor->ReadKey();
+    }
+    return cursors;
+}
+
 bool CCoinsViewDBCursor::GetKey(COutPoint &key) const
 {
     // Return cached key
@@ -215,15 +353,20 @@ bool CCoinsViewDBCursor::Valid() const
 void CCoinsViewDBCursor::Next()
 {
     pcursor->Next();
+    ReadKey();
+}
+
+void CCoinsViewDBCursor::ReadKey()
+{
     CoinEntry entry(&keyTmp.second);
-    if (!pcursor->Valid() || !pcursor->GetKey(entry)) {
+    if (!pcursor->Valid() || !pcursor->GetKey(entry) || (entry.key == DB_COIN && *keyTmp.second.hash.begin() >= end)) {
         keyTmp.first = 0; // Invalidate cached key after last record so that Valid() and GetKey() return false
     } else {
         keyTmp.first = entry.key;
     }
 }
 
-bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo) {
+bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo, const std::vector<std::pair<uint256, uint256>>& powhashes) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<int, const CBlockFileInfo*> >::const_iterator it=fileInfo.begin(); it != fileInfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_FILES, it->first), *it->second);
@@ -232,6 +375,9 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
+    for (const auto& powhash : powhashes) {
+        batch.Write(std::make_pair(DB_BLOCK_POW_HASH, powhash.first), powhash.second);
+    }
     return WriteBatch(batch, true);
 }
 
@@ -247,11 +393,32 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::ReadPoWHash(const uint256& block_hash, uint256& pow_hash) {
+    return Read(std::make_pair(DB_BLOCK_POW_HASH, block_hash), pow_hash);
+}
+
+/**
+ * Advance cursor, which walks the stored PoW hashes in the same (block hash) order as the block
+ * index is loaded, to the entry of block_hash. Returns whether there is one.
+ */
+static bool SeekPoWHash(CDBIterator& cursor, const uint256& block_hash, uint256& pow_hash)
+{
+    std::pair<char, uint256> key;
+    while (cursor.Valid() && cursor.GetKey(key) && key.first == DB_BLOCK_POW_HASH) {
+        if (key.second == block_hash) return cursor.GetValue(pow_hash);
+        if (block_hash < key.second) return false;
+        cursor.Next();
+    }
+    return false;
+}
+
 bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::unique_ptr<CDBIterator> ppowcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    ppowcursor->Seek(std::make_pair(DB_BLOCK_POW_HASH, uint256()));
 
     // Load m_block_index
     while (pcursor->Valid()) {
@@ -277,14 +444,15 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nTx            = diskindex.nTx;
 
 
-                // c0ban: Disable PoW Sanity check while loading block index from disk.
-                // We use the sha256 hash for the block index for performance reasons, which is recorded for later use.
-                // CheckProofOfWork() uses the scrypt hash which is discarded after a block is accepted.
-                // While it is technically feasible to verify the PoW, doing so takes several minutes as it
-                // requires recomputing every PoW hash during every Litecoin startup.
-                // We opt instead to simply trust the data that is on your local disk.
-                // if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                //     return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+                // c0ban: Recomputing every Lyra2 PoW hash here would take several minutes, so the PoW
+                // hash computed when the header was accepted is stored (see WriteBatchSync) and checked
+                // instead. Entries written before PoW hashes were stored are trusted as they are.
+                uint256 pow_hash;
+                if (SeekPoWHash(*ppowcursor, pindexNew->GetBlockHash(), pow_hash)) {
+                    const bool isPostFork = pindexNew->nHeight >= Params().SwitchLyra2REv2_LWMA();
+                    if (!CheckProofOfWork(pow_hash, pindexNew->nBits, isPostFork, consensusParams))
+                        return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+                }
 
                 pcursor->Next();
             } else {
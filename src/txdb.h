@@ -10,9 +10,13 @@
 #include <dbwrapper.h>
 #include <chain.h>
 #include <primitives/block.h>
+#include <sync.h>
 
+#include <condition_variable>
+#include <functional>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -44,11 +48,32 @@ class CCoinsViewDB final : public CCoinsView
 {
 protected:
     CDBWrapper db;
+
+private:
+    mutable Mutex m_writing_mutex;
+    mutable std::condition_variable m_writing_cv;
+    //! Coins being written by the background writer. Reads are answered from
+    //! them until they are in the database. The writer reads them without the
+    //! lock, so they only change once it has finished.
+    CCoinsMap m_writing;
+    //! The block m_writing is for, or null if there is none
+    uint256 m_writing_block GUARDED_BY(m_writing_mutex);
+    //! Whether coins are being written, in the background or by BatchWrite
+    bool m_writer_running GUARDED_BY(m_writing_mutex){false};
+    bool m_write_failed GUARDED_BY(m_writing_mutex){false};
+    std::thread m_writer;
+
+    uint256 ReadBestBlock() const;
+    //! Write the dirty coins of mapCoins, erasing its entries as they are batched if erase is set
+    bool WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase);
+    void BackgroundWrite(uint256 hashBlock, std::function<void(bool)> done);
+
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
      */
     explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -57,6 +82,27 @@ public:
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
     CCoinsViewCursor *Cursor() const override;
 
+    /**
+     * Take over mapCoins and write them in a background thread, like
+     * BatchWrite, returning before they are written. Reads see them
+     * meanwhile. Waits for an earlier background write first.
+     *
+     * @param[in] done    Called from the background thread with whether the write succeeded
+     * @return false if an earlier background write failed, in which case nothing is written
+     */
+    bool BatchWriteInBackground(CCoinsMap& mapCoins, const uint256& hashBlock, std::function<void(bool)> done);
+
+    //! Wait for a background write to finish. Returns false if it failed.
+    bool WaitForBackgroundWrite() const;
+
+    /**
+     * Split the coins into count ranges by the first byte of their txid (so at most 256), and
+     * return a cursor over each range, to read them in parallel. The cursors read the same
+     * snapshot of the database, unaffected by later writes. The snapshot is taken between
+     * writes; returns no cursors if the database was left in the middle of one.
+     */
+    std::vector<std::unique_ptr<CCoinsViewCursor>> Cursors(int count) const;
+
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
@@ -76,10 +122,15 @@ public:
     void Next() override;
 
 private:
-    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
-        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
+    CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn, int endIn = 256):
+        CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn), end(endIn) {}
     std::unique_ptr<CDBIterator> pcursor;
     std::pair<char, COutPoint> keyTmp;
+    //! The cursor stops at the first coin whose txid starts with this byte, if below 256
+    int end;
+
+    //! Cache the key at pcursor
+    void ReadKey();
 
     friend class CCoinsViewDB;
 };
@@ -90,13 +141,15 @@ class CBlockTreeDB : public CDBWrapper
 public:
     explicit CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
-    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
+    bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo, const std::vector<std::pair<uint256, uint256>>& powhashes);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &info);
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindexing);
     void ReadReindexing(bool &fReindexing);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    /** Read the PoW hash of an accepted block header, stored by WriteBatchSync so it never needs to be recomputed. */
+    bool ReadPoWHash(const uint256& block_hash, uint256& pow_hash);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
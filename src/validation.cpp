@@ -52,6 +52,7 @@
 #include <warnings.h>
 
 #include <string>
+#include <unordered_set>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -121,7 +122,10 @@ bool fPruneMode = false;
 bool fRequireStandard = true;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
+bool fParanoidBlockReads = DEFAULT_PARANOID_BLOCK_READS;
 size_t nCoinCacheUsage = 5000 * 300;
+int g_coins_cache_high = DEFAULT_COINS_CACHE_HIGH;
+int g_coins_cache_low = DEFAULT_COINS_CACHE_LOW;
 uint64_t nPruneTarget = 0;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
 
@@ -153,6 +157,9 @@ namespace {
 
     /** Dirty block file entries. */
     std::set<int> setDirtyFileInfo;
+
+    /** PoW hashes of accepted block headers, by block hash, written along with the dirty block index entries. */
+    std::map<uint256, uint256> mapDirtyPoWHash;
 } // anon namespace
 
 CBlockIndex* LookupBlockIndex(const uint256& hash)
@@ -162,6 +169,20 @@ CBlockIndex* LookupBlockIndex(const uint256& hash)
     return it == g_blockman.m_block_index.end() ? nullptr : it->second;
 }
 
+bool LookupPoWHash(const uint256& block_hash, uint256& pow_hash)
+{
+    {
+        LOCK(cs_main);
+        const auto it = mapDirtyPoWHash.find(block_hash);
+        if (it != mapDirtyPoWHash.end()) {
+            pow_hash = it->second;
+            return true;
+        }
+    }
+    // Flushing moves the hashes to the DB under cs_main, so one not found above is there if anywhere
+    return pblocktree->ReadPoWHash(block_hash, pow_hash);
+}
+
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator)
 {
     AssertLockHeld(cs_main);
@@ -1174,7 +1195,7 @@ static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessa
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, int nHeight, const Consensus::Params& consensusParams)
+static bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, int nHeight, const Consensus::Params& consensusParams, bool fCheckPOW)
 {
     block.SetNull();
 
@@ -1192,23 +1213,36 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, int nHeight, const
     }
 
     // Check the header
-    bool isPostFork = nHeight >= Params().SwitchLyra2REv2_LWMA();
-    bool isPostForkLyra2C0ban = nHeight >= Params().SwitchLyra2REvc0ban_LWMA();
-    if (!CheckProofOfWork(block.GetPoWHash(isPostFork, isPostForkLyra2C0ban), block.nBits, isPostFork, consensusParams))
-        return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+    if (fCheckPOW) {
+        bool isPostFork = nHeight >= Params().SwitchLyra2REv2_LWMA();
+        bool isPostForkLyra2C0ban = nHeight >= Params().SwitchLyra2REvc0ban_LWMA();
+        if (!CheckProofOfWork(block.GetPoWHash(isPostFork, isPostForkLyra2C0ban), block.nBits, isPostFork, consensusParams))
+            return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
+    }
 
     return true;
 }
 
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, int nHeight, const Consensus::Params& consensusParams)
+{
+    return ReadBlockFromDisk(block, pos, nHeight, consensusParams, true);
+}
+
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
     FlatFilePos blockPos;
+    bool fCheckPOW;
     {
         LOCK(cs_main);
         blockPos = pindex->GetBlockPos();
+        // The header of a block index entry that is at least BLOCK_VALID_TREE
+        // already passed CheckBlockHeader when it was accepted, so matching its
+        // hash below is enough to know the proof of work is valid. Recomputing
+        // the Lyra2 hash is only done when explicitly requested.
+        fCheckPOW = fParanoidBlockReads || !(pindex->nStatus & BLOCK_HAVE_DATA) || !pindex->IsValid(BLOCK_VALID_TREE);
     }
 
-    if (!ReadBlockFromDisk(block, blockPos, pindex->nHeight, consensusParams))
+    if (!ReadBlockFromDisk(block, blockPos, pindex->nHeight, consensusParams, fCheckPOW))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1519,6 +1553,18 @@ void InitScriptExecutionCache() {
             (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
 }
 
+CCheckQueuePool& ValidationPool()
+{
+    // Constructed on first use, as queues of other translation units attach during static initialization
+    static CCheckQueuePool pool;
+    return pool;
+}
+
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128, &ValidationPool(), VALIDATION_PRIORITY_BLOCK);
+
+/** Transactions checked outside a block with at least this many inputs have their scripts checked on the script check threads. */
+static const unsigned int MIN_PARALLEL_SCRIPT_CHECK_INPUTS = 8;
+
 /**
  * Check whether all of this transaction's input scripts succeed.
  *
@@ -1527,7 +1573,8 @@ void InitScriptExecutionCache() {
  *
  * If pvChecks is not nullptr, script checks are pushed onto it instead of being performed inline. Any
  * script checks which are not necessary (eg due to script execution cache hits) are, obviously,
- * not pushed onto pvChecks/run.
+ * not pushed onto pvChecks/run. If pvChecks is nullptr, transactions with at least
+ * MIN_PARALLEL_SCRIPT_CHECK_INPUTS inputs are still checked on the script check threads when those run.
  *
  * Setting cacheSigStore/cacheFullScriptStore to false will remove elements from the corresponding cache
  * which are matched. This is useful for checking blocks where we will likely never need the cache
@@ -1561,6 +1608,27 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState &state, const C
         return true;
     }
 
+    if (!pvChecks && g_parallel_script_checks && tx.vin.size() >= MIN_PARALLEL_SCRIPT_CHECK_INPUTS) {
+        // Check the inputs on the script check threads, as ConnectBlock does. Only if one fails
+        // are they checked again below, one at a time, to report the first failure. Inputs that
+        // passed are then found in the signature cache if cacheSigStore is set.
+        std::vector<CScriptCheck> vChecks;
+        vChecks.reserve(tx.vin.size());
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            const Coin& coin = inputs.AccessCoin(tx.vin[i].prevout);
+            assert(!coin.IsSpent());
+            vChecks.emplace_back(coin.out, tx, i, flags, cacheSigStore, &txdata);
+        }
+        CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+        control.Add(vChecks);
+        if (control.Wait()) {
+            if (cacheFullScriptStore) {
+                scriptExecutionCache.insert(hashCacheEntry);
+            }
+            return true;
+        }
+    }
+
     for (unsigned int i = 0; i < tx.vin.size(); i++) {
         const COutPoint &prevout = tx.vin[i].prevout;
         const Coin& coin = inputs.AccessCoin(prevout);
@@ -1821,11 +1889,9 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValidationSt
     return true;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
-
 void ThreadScriptCheck(int worker_num) {
     util::ThreadRename(strprintf("scriptch.%i", worker_num));
-    scriptcheckqueue.Thread();
+    ValidationPool().Thread();
 }
 
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
@@ -2271,10 +2337,8 @@ CoinsCacheSizeState CChainState::GetCoinsCacheSizeState(
     int64_t nTotalSpace =
         max_coins_cache_size_bytes + std::max<int64_t>(max_mempool_size_bytes - nMempoolUsage, 0);
 
-    //! No need to periodic flush if at least this much space still available.
-    static constexpr int64_t MAX_BLOCK_COINSDB_USAGE_BYTES = 10 * 1024 * 1024;  // 10MB
-    int64_t large_threshold =
-        std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE_BYTES);
+    //! A periodic flush is due above the high watermark.
+    int64_t large_threshold = (g_coins_cache_high * nTotalSpace) / 100;
 
     if (cacheSize > nTotalSpace) {
         LogPrintf("Cache size (%s) exceeds total space (%s)\n", cacheSize, nTotalSpace);
@@ -2373,7 +2437,9 @@ bool CChainState::FlushStateToDisk(
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
-                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
+                std::vector<std::pair<uint256, uint256>> vPoWHashes(mapDirtyPoWHash.begin(), mapDirtyPoWHash.end());
+                mapDirtyPoWHash.clear();
+                if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks, vPoWHashes)) {
                     return AbortNode(state, "Failed to write to block index database");
                 }
             }
@@ -2387,8 +2453,11 @@ bool CChainState::FlushStateToDisk(
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
         if (fDoFullFlush && !CoinsTip().GetBestBlock().IsNull()) {
-            LOG_TIME_SECONDS(strprintf("write coins cache to disk (%d coins, %.2fkB)",
-                coins_count, coins_mem_usage / 1000));
+            // Unless shutting down or pruning, which need the coins on disk
+            // now, the cache is written in the background.
+            const bool background = mode != FlushStateMode::ALWAYS && !fFlushForPrune;
+            LOG_TIME_SECONDS(strprintf("%s coins cache to disk (%d coins, %.2fkB)",
+                background ? "queue" : "write", coins_count, coins_mem_usage / 1000));
 
             // Typical Coin structures on disk are around 48 bytes in size.
             // Pushing a new one to the database can cause it to be written
@@ -2399,10 +2468,35 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
-                return AbortNode(state, "Failed to write to coin database");
+            if (!background) {
+                if (!CoinsTip().Flush())
+                    return AbortNode(state, "Failed to write to coin database");
+                full_flush_completed = true;
+            } else {
+                // Validation continues on a cache holding only the recently
+                // created coins up to the low watermark, which reads the
+                // coins being written from the database view until they are
+                // on disk. Only one write runs at a time.
+                if (!CoinsDB().WaitForBackgroundWrite())
+                    return AbortNode(state, "Failed to write to coin database");
+                const uint256 best_block = CoinsTip().GetBestBlock();
+                const CBlockLocator locator = m_chain.GetLocator();
+                CCoinsMap coins;
+                CoinsTip().ReleaseCache(coins, nCoinCacheUsage / 100 * g_coins_cache_low);
+                // The dirty coins have left the cache, so if the write
+                // cannot be queued they are lost and the node must stop.
+                if (!CoinsDB().BatchWriteInBackground(coins, best_block, [locator](bool ok) {
+                        if (ok) {
+                            // Update best block in wallet (so we can detect restored wallets).
+                            GetMainSignals().ChainStateFlushed(locator);
+                        } else {
+                            AbortNode("Failed to write to coin database");
+                        }
+                    })) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
+            }
             nLastFlush = nNow;
-            full_flush_completed = true;
         }
     }
     if (full_flush_completed) {
@@ -2557,6 +2651,7 @@ bool CChainState::DisconnectTip(BlockValidationState& state, const CChainParams&
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2602,6 +2697,87 @@ public:
     }
 };
 
+/**
+ * Closure representing the lookup of a few coins in the coins database. Lookups never fail;
+ * coins that could not be read are left spent, and are looked up again the regular way.
+ */
+class CCoinsPrefetch
+{
+private:
+    const CCoinsView* m_db{nullptr};
+    const COutPoint* m_outpoints{nullptr};
+    Coin* m_coins{nullptr};
+    size_t m_count{0};
+
+public:
+    CCoinsPrefetch() {}
+    CCoinsPrefetch(const CCoinsView* db, const COutPoint* outpoints, Coin* coins, size_t count) :
+        m_db(db), m_outpoints(outpoints), m_coins(coins), m_count(count) {}
+
+    bool operator()() {
+        for (size_t i = 0; i < m_count; ++i) {
+            try {
+                if (!m_db->GetCoin(m_outpoints[i], m_coins[i])) m_coins[i].Clear();
+            } catch (const std::runtime_error&) {
+                // Read errors are left to the regular lookup, which knows how to handle them
+                m_coins[i].Clear();
+            }
+        }
+        return true;
+    }
+
+    void swap(CCoinsPrefetch& check) {
+        std::swap(m_db, check.m_db);
+        std::swap(m_outpoints, check.m_outpoints);
+        std::swap(m_coins, check.m_coins);
+        std::swap(m_count, check.m_count);
+    }
+};
+
+/** Coins looked up per CCoinsPrefetch. */
+static const size_t COINS_PREFETCH_SIZE = 8;
+
+static CCheckQueue<CCoinsPrefetch> coinprefetchqueue(1, &ValidationPool(), VALIDATION_PRIORITY_BLOCK);
+
+/**
+ * Read the coins a block spends that are not in the coins cache from the coins database, on
+ * the coin prefetching threads, and add them to the cache. ConnectBlock then finds its inputs
+ * in memory, instead of waiting on one database read after another.
+ */
+static void PrefetchBlockInputs(const CBlock& block, CCoinsViewCache& cache, const CCoinsViewDB& db)
+{
+    if (!g_parallel_script_checks) return;
+
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    for (const CTransactionRef& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> outpoints;
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!block_txids.count(txin.prevout.hash) && !cache.HaveCoinInCache(txin.prevout)) {
+                outpoints.push_back(txin.prevout);
+            }
+        }
+    }
+    if (outpoints.size() < 2 * COINS_PREFETCH_SIZE) return;
+
+    std::vector<Coin> coins(outpoints.size());
+    {
+        CCheckQueueControl<CCoinsPrefetch> control(&coinprefetchqueue);
+        std::vector<CCoinsPrefetch> checks;
+        for (size_t begin = 0; begin < outpoints.size(); begin += COINS_PREFETCH_SIZE) {
+            checks.emplace_back(&db, &outpoints[begin], &coins[begin], std::min(COINS_PREFETCH_SIZE, outpoints.size() - begin));
+        }
+        control.Add(checks);
+        control.Wait();
+    }
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        if (!coins[i].IsSpent()) cache.AddFetchedCoin(outpoints[i], std::move(coins[i]));
+    }
+}
+
 /**
  * Connect a new block to m_chain. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2627,6 +2803,9 @@ bool CChainState::ConnectTip(BlockValidationState& state, const CChainParams& ch
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    PrefetchBlockInputs(blockConnecting, CoinsTip(), CoinsDB());
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint(BCLog::BENCH, "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTimePrefetched - nTime2) * MILLI, nTimePrefetch * MICRO);
     {
         CCoinsViewCache view(&CoinsTip());
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -3327,7 +3506,11 @@ static bool FindUndoPos(BlockValidationState &state, int nFile, FlatFilePos &pos
     return true;
 }
 
-static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
+/**
+ * pow_hash, if given, is the header's PoW hash computed in advance for the algorithm in use at its height.
+ * pow_hash_out, if given, receives the PoW hash that was checked.
+ */
+static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true, const uint256* pow_hash = nullptr, uint256* pow_hash_out = nullptr)
 {
     // Get prev block index
     CBlockIndex* pindexPrev = NULL;
@@ -3345,25 +3528,85 @@ static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& st
     // Check proof of work matches claimed amount
     bool isPostFork = nHeight >= Params().SwitchLyra2REv2_LWMA();
     bool isPostForkLyra2C0ban = nHeight >= Params().SwitchLyra2REvc0ban_LWMA();
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(isPostFork, isPostForkLyra2C0ban), block.nBits, isPostFork, consensusParams)) {
-        return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
+    if (fCheckPOW) {
+        const uint256 hashPoW = pow_hash ? *pow_hash : block.GetPoWHash(isPostFork, isPostForkLyra2C0ban);
+        if (!CheckProofOfWork(hashPoW, block.nBits, isPostFork, consensusParams)) {
+            return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
+        }
+        if (pow_hash_out) *pow_hash_out = hashPoW;
     }
 
     return true;
 }
 
-bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
+/**
+ * Closure representing the context-free checks of a few of a block's transactions: CheckTransaction,
+ * which includes the duplicate input check, and the count of their legacy sigops.
+ */
+class CBlockTxCheck
 {
-    // These are checks that are independent of context.
+private:
+    const CTransactionRef* m_txs{nullptr};
+    size_t m_count{0};
+    unsigned int* m_sigops{nullptr};
 
-    if (block.fChecked)
+public:
+    CBlockTxCheck() {}
+    CBlockTxCheck(const CTransactionRef* txs, size_t count, unsigned int* sigops) :
+        m_txs(txs), m_count(count), m_sigops(sigops) {}
+
+    bool operator()() {
+        unsigned int sigops = 0;
+        for (size_t i = 0; i < m_count; ++i) {
+            TxValidationState tx_state;
+            if (!CheckTransaction(*m_txs[i], tx_state)) return false;
+            sigops += GetLegacySigOpCount(*m_txs[i]);
+        }
+        *m_sigops = sigops;
         return true;
+    }
 
-    // Check that the header is valid (particularly PoW).  This is mostly
-    // redundant with the call in AcceptBlockHeader.
-    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
-        return false;
+    void swap(CBlockTxCheck& check) {
+        std::swap(m_txs, check.m_txs);
+        std::swap(m_count, check.m_count);
+        std::swap(m_sigops, check.m_sigops);
+    }
+};
+
+/** Transactions checked per CBlockTxCheck. */
+static const size_t BLOCK_TX_CHECK_SIZE = 16;
+
+static CCheckQueue<CBlockTxCheck> blocktxcheckqueue(1, &ValidationPool(), VALIDATION_PRIORITY_BLOCK);
+
+/**
+ * Check all of a block's transactions on the block transaction checking threads, and count
+ * their legacy sigops into nSigOps. Returns false if the checks were not run, because there are
+ * no such threads or too few transactions to split, or if any of them failed; the caller then
+ * checks the transactions in order, which also finds the first invalid one to report.
+ */
+static bool CheckBlockTransactionsParallel(const CBlock& block, unsigned int& nSigOps)
+{
+    if (!g_parallel_script_checks || block.vtx.size() <= BLOCK_TX_CHECK_SIZE) return false;
+
+    std::vector<unsigned int> sigops((block.vtx.size() + BLOCK_TX_CHECK_SIZE - 1) / BLOCK_TX_CHECK_SIZE);
+    CCheckQueueControl<CBlockTxCheck> control(&blocktxcheckqueue);
+    std::vector<CBlockTxCheck> checks;
+    for (size_t begin = 0; begin < block.vtx.size(); begin += BLOCK_TX_CHECK_SIZE) {
+        checks.emplace_back(&block.vtx[begin], std::min(BLOCK_TX_CHECK_SIZE, block.vtx.size() - begin), &sigops[begin / BLOCK_TX_CHECK_SIZE]);
+    }
+    control.Add(checks);
+    if (!control.Wait()) return false;
+
+    nSigOps = 0;
+    for (const unsigned int count : sigops) {
+        nSigOps += count;
+    }
+    return true;
+}
 
+/** The checks of CheckBlock() after the header; unlike that one, they don't look at the block index. */
+static bool CheckBlockContents(const CBlock& block, BlockValidationState& state, bool fCheckMerkleRoot)
+{
     // Check the merkle root.
     if (fCheckMerkleRoot) {
         bool mutated;
@@ -3397,24 +3640,45 @@ bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensu
 
     // Check transactions
     // Must check for duplicate inputs (see CVE-2018-17144)
-    for (const auto& tx : block.vtx) {
-        TxValidationState tx_state;
-        if (!CheckTransaction(*tx, tx_state)) {
-            // CheckBlock() does context-free validation checks. The only
-            // possible failures are consensus failures.
-            assert(tx_state.GetResult() == TxValidationResult::TX_CONSENSUS);
-            return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, tx_state.GetRejectReason(),
-                                 strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), tx_state.GetDebugMessage()));
-        }
-    }
     unsigned int nSigOps = 0;
-    for (const auto& tx : block.vtx)
-    {
-        nSigOps += GetLegacySigOpCount(*tx);
+    if (!CheckBlockTransactionsParallel(block, nSigOps)) {
+        for (const auto& tx : block.vtx) {
+            TxValidationState tx_state;
+            if (!CheckTransaction(*tx, tx_state)) {
+                // CheckBlock() does context-free validation checks. The only
+                // possible failures are consensus failures.
+                assert(tx_state.GetResult() == TxValidationResult::TX_CONSENSUS);
+                return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, tx_state.GetRejectReason(),
+                                     strprintf("Transaction check failed (tx hash %s) %s", tx->GetHash().ToString(), tx_state.GetDebugMessage()));
+            }
+        }
+        nSigOps = 0;
+        for (const auto& tx : block.vtx)
+        {
+            nSigOps += GetLegacySigOpCount(*tx);
+        }
     }
     if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-blk-sigops", "out-of-bounds SigOpCount");
 
+    return true;
+}
+
+bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW, bool fCheckMerkleRoot)
+{
+    // These are checks that are independent of context.
+
+    if (block.fChecked)
+        return true;
+
+    // Check that the header is valid (particularly PoW).  This is mostly
+    // redundant with the call in AcceptBlockHeader.
+    if (!CheckBlockHeader(block, state, consensusParams, fCheckPOW))
+        return false;
+
+    if (!CheckBlockContents(block, state, fCheckMerkleRoot))
+        return false;
+
     if (fCheckPOW && fCheckMerkleRoot)
         block.fChecked = true;
 
@@ -3637,13 +3901,14 @@ static bool ContextualCheckBlock(const CBlock& block, BlockValidationState& stat
     return true;
 }
 
-bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, const uint256* pow_hash)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
     uint256 hash = block.GetHash();
     BlockMap::iterator miSelf = m_block_index.find(hash);
     CBlockIndex *pindex = nullptr;
+    uint256 hashPoW;
     if (hash != chainparams.GetConsensus().hashGenesisBlock) {
         if (miSelf != m_block_index.end()) {
             // Block header is already known.
@@ -3657,7 +3922,7 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationS
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), true, pow_hash, &hashPoW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), state.ToString());
 
         // Get prev block index
@@ -3717,20 +3982,184 @@ bool BlockManager::AcceptBlockHeader(const CBlockHeader& block, BlockValidationS
     if (pindex == nullptr)
         pindex = AddToBlockIndex(block);
 
+    // Keep the PoW hash, so it can be checked cheaply when the block index is loaded. It is
+    // written with the block index entry at the next flush.
+    if (!hashPoW.IsNull())
+        mapDirtyPoWHash.emplace(hash, hashPoW);
+
     if (ppindex)
         *ppindex = pindex;
 
     return true;
 }
 
+/** The number of headers GetPoWHashBatch hashes at once. */
+static const size_t HEADER_POW_LANES = 4;
+
+/** Marks a CHeaderPoWCheck the check queue skipped after another check failed. */
+static const size_t HEADER_POW_NOT_CHECKED = std::numeric_limits<size_t>::max();
+
+/**
+ * Closure representing the PoW check of a few consecutive headers that share a PoW algorithm.
+ * The hashes are kept for AcceptBlockHeader, and the number of leading headers that pass is
+ * stored in *passed. A header that fails its target fails the check, so the rest of a bad
+ * batch is not hashed.
+ */
+class CHeaderPoWCheck
+{
+private:
+    const CBlockHeader* m_headers{nullptr};
+    uint256* m_hashes{nullptr};
+    size_t m_count{0};
+    bool m_lyra2rev2{false};
+    bool m_lyra2rec0ban{false};
+    const Consensus::Params* m_params{nullptr};
+    size_t* m_passed{nullptr};
+
+public:
+    CHeaderPoWCheck() {}
+    CHeaderPoWCheck(const CBlockHeader* headers, uint256* hashes, size_t count, bool lyra2rev2, bool lyra2rec0ban, const Consensus::Params& params, size_t* passed) :
+        m_headers(headers), m_hashes(hashes), m_count(count), m_lyra2rev2(lyra2rev2), m_lyra2rec0ban(lyra2rec0ban), m_params(&params), m_passed(passed) {}
+
+    bool operator()() {
+        // Hash as many headers at a time as GetPoWHashBatch has lanes, checking each group
+        for (size_t begin = 0; begin < m_count; begin += HEADER_POW_LANES) {
+            const size_t count = std::min(HEADER_POW_LANES, m_count - begin);
+            GetPoWHashBatch(Span<const CBlockHeader>(m_headers + begin, count), Span<uint256>(m_hashes + begin, count), m_lyra2rev2, m_lyra2rec0ban);
+            for (size_t i = begin; i < begin + count; ++i) {
+                if (!CheckProofOfWork(m_hashes[i], m_headers[i].nBits, m_lyra2rev2, *m_params)) {
+                    *m_passed = i;
+                    return false;
+                }
+            }
+        }
+        *m_passed = m_count;
+        return true;
+    }
+
+    void swap(CHeaderPoWCheck& check) {
+        std::swap(m_headers, check.m_headers);
+        std::swap(m_hashes, check.m_hashes);
+        std::swap(m_count, check.m_count);
+        std::swap(m_lyra2rev2, check.m_lyra2rev2);
+        std::swap(m_lyra2rec0ban, check.m_lyra2rec0ban);
+        std::swap(m_params, check.m_params);
+        std::swap(m_passed, check.m_passed);
+    }
+};
+
+/** Headers hashed per CHeaderPoWCheck; a multiple of the lanes GetPoWHashBatch hashes at once. */
+static const size_t HEADER_POW_CHECK_SIZE = 16;
+
+static CCheckQueue<CHeaderPoWCheck> headerpowcheckqueue(1, &ValidationPool(), VALIDATION_PRIORITY_HEADERS);
+
+/**
+ * Find the headers of a headers message whose PoW hash can be computed in advance. Headers
+ * already in the block index are skipped, and of the rest only the leading run that connects
+ * to a known block and to each other qualifies, as only for those the height, and so the PoW
+ * algorithm, is known. Returns the range [begin, end) and the height of the block before it.
+ */
+static void FindHeadersToHash(const std::vector<CBlockHeader>& headers, size_t& begin, size_t& end, int& prev_height) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    begin = end = 0;
+    while (begin < headers.size() && LookupBlockIndex(headers[begin].GetHash())) {
+        ++begin;
+    }
+    if (begin == headers.size()) {
+        end = begin;
+        return;
+    }
+    const CBlockIndex* pindexPrev = LookupBlockIndex(headers[begin].hashPrevBlock);
+    if (!pindexPrev) {
+        end = begin;
+        return;
+    }
+    prev_height = pindexPrev->nHeight;
+
+    end = begin + 1;
+    while (end < headers.size() && headers[end].hashPrevBlock == headers[end - 1].GetHash()) {
+        ++end;
+    }
+}
+
+/**
+ * Compute the PoW hashes of headers[begin, end) into pow_hashes and check them against the
+ * headers' targets, on the header-checking threads if there are any. Returns the index of the
+ * first header that fails, or headers.size() if none does; the headers before it have their
+ * hash in pow_hashes. Must not be called with cs_main held, as this is the expensive part of
+ * header validation.
+ */
+static size_t CheckHeadersPoW(const std::vector<CBlockHeader>& headers, size_t begin, size_t end, int prev_height, const Consensus::Params& params, std::vector<uint256>& pow_hashes) LOCKS_EXCLUDED(cs_main)
+{
+    pow_hashes.resize(end);
+    // The checks of the runs in order, with the number of leading headers of each that passed
+    std::vector<CHeaderPoWCheck> runs;
+    std::vector<size_t> run_begins;
+    std::vector<size_t> passed;
+    passed.reserve(end - begin);
+    CCheckQueueControl<CHeaderPoWCheck> control(g_parallel_script_checks ? &headerpowcheckqueue : nullptr);
+    std::vector<CHeaderPoWCheck> checks;
+
+    // Hash each run of headers that share a PoW algorithm in chunks
+    for (size_t run_begin = begin, run_end; run_begin < end; run_begin = run_end) {
+        const int nHeight = prev_height + 1 + (run_begin - begin);
+        const bool isPostFork = nHeight >= Params().SwitchLyra2REv2_LWMA();
+        const bool isPostForkLyra2C0ban = nHeight >= Params().SwitchLyra2REvc0ban_LWMA();
+        for (run_end = run_begin + 1; run_end < end && run_end - run_begin < HEADER_POW_CHECK_SIZE; ++run_end) {
+            const int nHeightEnd = prev_height + 1 + (run_end - begin);
+            if ((nHeightEnd >= Params().SwitchLyra2REv2_LWMA()) != isPostFork ||
+                (nHeightEnd >= Params().SwitchLyra2REvc0ban_LWMA()) != isPostForkLyra2C0ban) break;
+        }
+        passed.push_back(HEADER_POW_NOT_CHECKED);
+        CHeaderPoWCheck check(&headers[run_begin], &pow_hashes[run_begin], run_end - run_begin, isPostFork, isPostForkLyra2C0ban, params, &passed.back());
+        if (g_parallel_script_checks) {
+            runs.push_back(check);
+            run_begins.push_back(run_begin);
+            checks.emplace_back();
+            check.swap(checks.back());
+        } else if (!check()) {
+            return run_begin + passed.back();
+        }
+    }
+    control.Add(checks);
+    if (control.Wait()) return headers.size();
+
+    // Find the first header that failed. Once a check fails the queue skips the others, so a
+    // skipped run before the failing one is checked now, as one of its headers may fail first.
+    for (size_t i = 0; i < runs.size(); ++i) {
+        if (passed[i] == HEADER_POW_NOT_CHECKED) runs[i]();
+        const size_t run_end = i + 1 < runs.size() ? run_begins[i + 1] : end;
+        if (run_begins[i] + passed[i] < run_end) return run_begins[i] + passed[i];
+    }
+    assert(false);
+    return headers.size();
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, BlockValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Compute and check the PoW hashes first, without holding cs_main. The heights of the headers (which
+    // decide the PoW algorithm) follow from their already known ancestor, whose height cannot change.
+    size_t hashed_begin, hashed_end;
+    int prev_height = 0;
+    {
+        LOCK(cs_main);
+        FindHeadersToHash(headers, hashed_begin, hashed_end, prev_height);
+    }
+    std::vector<uint256> pow_hashes;
+    const size_t first_bad_pow = CheckHeadersPoW(headers, hashed_begin, hashed_end, prev_height, chainparams.GetConsensus(), pow_hashes);
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const CBlockHeader& header = headers[i];
+            if (i == first_bad_pow) {
+                // The headers before it are accepted, as if each had been checked on its own
+                state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
+                return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, header.GetHash().ToString(), state.ToString());
+            }
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            bool accepted = g_blockman.AcceptBlockHeader(header, state, chainparams, &pindex);
+            bool accepted = g_blockman.AcceptBlockHeader(header, state, chainparams, &pindex, i >= hashed_begin && i < hashed_end ? &pow_hashes[i] : nullptr);
             ::ChainstateActive().CheckBlockIndex(chainparams.GetConsensus());
 
             if (!accepted) {
@@ -3769,7 +4198,7 @@ static FlatFilePos SaveBlockToDisk(const CBlock& block, int nHeight, const CChai
 }
 
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
-bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock)
+bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, const uint256* pow_hash)
 {
     const CBlock& block = *pblock;
 
@@ -3779,7 +4208,7 @@ bool CChainState::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, Block
     CBlockIndex *pindexDummy = nullptr;
     CBlockIndex *&pindex = ppindex ? *ppindex : pindexDummy;
 
-    bool accepted_header = m_blockman.AcceptBlockHeader(block, state, chainparams, &pindex);
+    bool accepted_header = m_blockman.AcceptBlockHeader(block, state, chainparams, &pindex, pow_hash);
     CheckBlockIndex(chainparams.GetConsensus());
 
     if (!accepted_header)
@@ -3860,16 +4289,54 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         if (fNewBlock) *fNewBlock = false;
         BlockValidationState state;
 
-        // CheckBlock() does not support multi-threaded block validation because CBlock::fChecked can cause data race.
-        // Therefore, the following critical section must include the CheckBlock() call as well.
+        // fChecked is shared with the other CheckBlock() callers, which run under cs_main, so it
+        // is only accessed under the lock. The height of the parent decides the PoW algorithm.
+        bool already_checked;
+        int prev_height = -1;
+        {
+            LOCK(cs_main);
+            already_checked = pblock->fChecked;
+            const CBlockIndex* pindexPrev = LookupBlockIndex(pblock->hashPrevBlock);
+            if (pindexPrev) prev_height = pindexPrev->nHeight;
+        }
+
+        // Check the proof of work, and then the parts of CheckBlock() that don't need the block
+        // index, before taking cs_main for the rest. The transactions of a block with a bad
+        // header are not looked at. A block that already passed CheckBlock() (as reconstructed
+        // compact blocks have) is not hashed again.
+        uint256 pow_hash;
+        bool contents_checked = false;
+        bool contents_ok = false;
+        if (!already_checked) {
+            const int nHeight = prev_height + 1;
+            const bool isPostFork = nHeight >= chainparams.SwitchLyra2REv2_LWMA();
+            const bool isPostForkLyra2C0ban = nHeight >= chainparams.SwitchLyra2REvc0ban_LWMA();
+            pow_hash = pblock->GetPoWHash(isPostFork, isPostForkLyra2C0ban);
+            contents_checked = CheckProofOfWork(pow_hash, pblock->nBits, isPostFork, chainparams.GetConsensus());
+            contents_ok = contents_checked && CheckBlockContents(*pblock, state, true);
+        }
+
         LOCK(cs_main);
 
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
-        // belt-and-suspenders.
-        bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        // belt-and-suspenders. The header comes first, as in CheckBlock(). Its parent may have
+        // been added meanwhile, which can change the PoW algorithm, so the hash above is only
+        // reused if the parent's height still holds (and the contents are checked here if the
+        // header only passes now).
+        const uint256* known_pow_hash = nullptr;
+        bool ret = true;
+        if (!already_checked) {
+            const CBlockIndex* pindexPrev = LookupBlockIndex(pblock->hashPrevBlock);
+            if ((pindexPrev ? pindexPrev->nHeight : -1) == prev_height) known_pow_hash = &pow_hash;
+            ret = CheckBlockHeader(*pblock, state, chainparams.GetConsensus(), true, known_pow_hash);
+            if (ret) {
+                ret = contents_checked ? contents_ok : CheckBlockContents(*pblock, state, true);
+                if (ret) pblock->fChecked = true;
+            }
+        }
         if (ret) {
             // Store to disk
-            ret = ::ChainstateActive().AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
+            ret = ::ChainstateActive().AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock, known_pow_hash);
         }
         if (!ret) {
             GetMainSignals().BlockChecked(*pblock, state);
@@ -4635,6 +5102,7 @@ void UnloadBlockIndex()
     nLastBlockFile = 0;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    mapDirtyPoWHash.clear();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
         warningcache[b].clear();
@@ -38,6 +38,7 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CBlockUndo;
 class CChainParams;
+class CCheckQueuePool;
 class CInv;
 class CConnman;
 class CScriptCheck;
@@ -78,7 +79,7 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 
 /** Maximum number of dedicated script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 15;
+static const int MAX_SCRIPTCHECK_THREADS = 63;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
 /** Number of blocks that can be requested at any given time from a single peer. */
@@ -114,6 +115,12 @@ static const int64_t MAX_FEE_ESTIMATION_TIP_AGE = 3 * 60 * 60;
 // TODO: set DEFAULT_CHECKPOINTS_ENABLED to false because it is necessary to adjust the parameter and test it
 static const bool DEFAULT_CHECKPOINTS_ENABLED = false;
 static const bool DEFAULT_TXINDEX = false;
+/** Default for -paranoidblockreads */
+static const bool DEFAULT_PARANOID_BLOCK_READS = false;
+/** Default for -dbcachehigh */
+static const int DEFAULT_COINS_CACHE_HIGH = 90;
+/** Default for -dbcachelow */
+static const int DEFAULT_COINS_CACHE_LOW = 50;
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 /** Default for -persistmempool */
@@ -147,14 +154,21 @@ extern std::condition_variable g_best_block_cv;
 extern uint256 g_best_block;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
-/** Whether there are dedicated script-checking threads running.
+/** Whether there are dedicated script-checking (and header PoW checking) threads running.
  * False indicates all script checking is done on the main threadMessageHandler thread.
  */
 extern bool g_parallel_script_checks;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
+/** Whether ReadBlockFromDisk recomputes the proof of work of blocks whose header was already validated. */
+extern bool fParanoidBlockReads;
 extern size_t nCoinCacheUsage;
+/** Watermarks in percent of the coins cache limit: above the high one the cache
+ *  is flushed at the next opportunity, and a flush keeps recently created coins
+ *  in memory up to the low one. */
+extern int g_coins_cache_high;
+extern int g_coins_cache_low;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** If the tip is older than this (in seconds), the node is considered to be in initial block download. */
@@ -242,8 +256,20 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Unload database information */
 void UnloadBlockIndex();
-/** Run an instance of the script checking thread */
+/** Run an instance of the script checking thread, which also does the other validation work that runs in parallel */
 void ThreadScriptCheck(int worker_num);
+/**
+ * Pool of the script check threads. Other work that can be done in parallel is queued on them
+ * too, by priority, so that it uses the same cores instead of threads of its own. Queues attach
+ * to it when they are constructed, before the threads start.
+ */
+CCheckQueuePool& ValidationPool();
+/** Priority of the work on ValidationPool() for connecting and checking blocks, which goes first. */
+static const int VALIDATION_PRIORITY_BLOCK = 0;
+/** Priority of the work on ValidationPool() for checking headers. */
+static const int VALIDATION_PRIORITY_HEADERS = 1;
+/** Priority of the work on ValidationPool() for scanning the UTXO set on request, which goes last. */
+static const int VALIDATION_PRIORITY_STATS = 2;
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr);
 /**
@@ -408,6 +434,9 @@ public:
 
 CBlockIndex* LookupBlockIndex(const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/** Look up the PoW hash of an accepted block header, whether or not it has been written to the block tree DB yet. */
+bool LookupPoWHash(const uint256& block_hash, uint256& pow_hash) LOCKS_EXCLUDED(cs_main);
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
@@ -494,12 +523,14 @@ public:
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to m_block_index.
+     * pow_hash, if given, is the header's precomputed PoW hash.
      */
     bool AcceptBlockHeader(
         const CBlockHeader& block,
         BlockValidationState& state,
         const CChainParams& chainparams,
-        CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+        CBlockIndex** ppindex,
+        const uint256* pow_hash = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 };
 
 /**
@@ -700,7 +731,8 @@ public:
         const CChainParams& chainparams,
         std::shared_ptr<const CBlock> pblock) LOCKS_EXCLUDED(cs_main);
 
-    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** pow_hash, if given, is the block header's precomputed PoW hash. */
+    bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, const uint256* pow_hash = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view);
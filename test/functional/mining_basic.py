@@ -246,6 +246,12 @@ class MiningTest(BitcoinTestFramework):
         node.submitheader(hexdata=CBlockHeader(bad_block_root).serialize().hex())
         assert_equal(node.submitblock(hexdata=block.serialize().hex()), 'duplicate')  # valid
 
+        self.log.info('generatetoaddress: search nonces on several threads')
+        height = node.getblockcount()
+        node.generatetoaddress(5, node.get_deterministic_priv_key().address, 1000000, 4)
+        assert_equal(node.getblockcount(), height + 5)
+        assert_raises_rpc_error(-8, 'threads must be between 1 and 64', node.generatetoaddress, 1, node.get_deterministic_priv_key().address, 1000000, 0)
+
 
 if __name__ == '__main__':
     MiningTest().main()
@@ -54,6 +54,13 @@ class RpcMiscTest(BitcoinTestFramework):
 
         assert_raises_rpc_error(-8, "unknown mode foobar", node.getmemoryinfo, mode="foobar")
 
+        self.log.info("test getsigcacheinfo")
+        sigcache = node.getsigcacheinfo()
+        assert_greater_than(sigcache['capacity'], 0)
+        for key in ['hits', 'misses', 'inserts', 'evictions']:
+            assert_greater_than_or_equal(sigcache[key], 0)
+        assert_greater_than_or_equal(sigcache['inserts'], sigcache['evictions'])
+
         self.log.info("test logging")
         assert_equal(node.logging()['qt'], True)
         node.logging(exclude=['qt'])